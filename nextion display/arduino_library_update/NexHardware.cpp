@@ -32,6 +32,17 @@
 #define NEX_RET_INVALID_VARIABLE        (0x1A)
 #define NEX_RET_INVALID_OPERATION       (0x1B)
 
+/*
+ * Touch event frame parser state. 
+ * 
+ * A touch event frame is 7 bytes: 0x65, page id, component id, event, 0xFF 0xFF 0xFF. 
+ * nexLoop consumes only the bytes already received, so a frame may be split over 
+ * several calls: __touch_count holds how many bytes of the current frame have been seen. 
+ */
+#define NEX_TOUCH_FRAME_LENGTH  (7)
+static uint8_t __touch_buffer[NEX_TOUCH_FRAME_LENGTH];
+static uint8_t __touch_count = 0;
+
 /*
  * Receive uint32_t data. 
  * 
@@ -167,6 +178,7 @@ void sendCommand(const char* cmd)
     {
         nexSerial.read();
     }
+    __touch_count = 0;
     
     nexSerial.print(cmd);
     nexSerial.write(0xFF);
@@ -232,35 +244,57 @@ bool nexInit(long Speed)
     return ret1 && ret2;
 }
 
-void nexLoop(NexTouch *nex_listen_list[])
+/*
+ * Add one received byte to the touch event frame parser. 
+ * 
+ * Bytes outside a touch frame are discarded. If a frame doesn't end in 0xFF 0xFF 0xFF 
+ * it is discarded, and the parser resynchronises on the next 0x65. 
+ *
+ * @retval true - a complete touch event frame is in __touch_buffer. 
+ * @retval false - otherwise. 
+ */
+static bool nexParseTouchByte(uint8_t c)
 {
-    static uint8_t __buffer[10];
-    
-    uint16_t i;
-    uint8_t c;  
+    bool ret = false;
     
+    if (__touch_count == 0)
+    {
+        if (NEX_RET_EVENT_TOUCH_HEAD == c)
+        {
+            __touch_buffer[__touch_count++] = c;
+        }
+    }
+    else if (__touch_count < 4)
+    {
+        __touch_buffer[__touch_count++] = c;
+    }
+    else if (0xFF == c)
+    {
+        __touch_buffer[__touch_count++] = c;
+        if (__touch_count == NEX_TOUCH_FRAME_LENGTH)
+        {
+            __touch_count = 0;
+            ret = true;
+        }
+    }
+    else
+    {
+        __touch_count = 0;
+        if (NEX_RET_EVENT_TOUCH_HEAD == c)
+        {
+            __touch_buffer[__touch_count++] = c;
+        }
+    }
+    return ret;
+}
+
+void nexLoop(NexTouch *nex_listen_list[])
+{
     while (nexSerial.available() > 0)
     {   
-        delay(10);
-        c = nexSerial.read();
-        
-        if (NEX_RET_EVENT_TOUCH_HEAD == c)
+        if (nexParseTouchByte(nexSerial.read()))
         {
-            if (nexSerial.available() >= 6)
-            {
-                __buffer[0] = c;  
-                for (i = 1; i < 7; i++)
-                {
-                    __buffer[i] = nexSerial.read();
-                }
-                __buffer[i] = 0x00;
-                
-                if (0xFF == __buffer[4] && 0xFF == __buffer[5] && 0xFF == __buffer[6])
-                {
-                    NexTouch::iterate(nex_listen_list, __buffer[1], __buffer[2], (int32_t)__buffer[3]);
-                }
-                
-            }
+            NexTouch::iterate(nex_listen_list, __touch_buffer[1], __touch_buffer[2], (int32_t)__touch_buffer[3]);
         }
     }
 }
@@ -38,6 +38,9 @@ bool nexInit(long Speed = 9600);
  * @param nex_listen_list - index to Nextion Components list. 
  * @return none. 
  *
+ * It never blocks: it consumes only the bytes already received, and a touch event
+ * split over several calls is completed on a later call. 
+ *
  * @warning This function must be called repeatedly to response touch events
  *  from Nextion touch panel. Actually, you should place it in your loop function. 
  */
@@ -0,0 +1,221 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// adcconvert.h
+// this file holds the conversions from ADC reading to sensor value, and the flash lookup tables
+// they use, all generated at compile time. Only analogueio.cpp should include it (each file
+// that includes it gets its own copy of the tables).
+// it has no Arduino dependencies, so it can also be built on a host (see test/)
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __ADCCONVERT_H
+#define __ADCCONVERT_H
+
+#include <math.h>
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#endif
+#ifndef PROGMEM
+#define PROGMEM                                             // host build: tables are in RAM
+#endif
+#ifndef pgm_read_word
+#define pgm_read_word(Address) (*(const unsigned short*)(Address))
+#endif
+
+
+//
+// scaling factors to convert from ADC reading to sensed value
+// note these are for true ISO units, not scaled by a factor of 10 for 1 decimapl place
+// see spreadsheet for derivation
+//
+#define VFWDPOWERSCALE 0.002968131F         // convert ADC reading squared to forward watts
+#define VREVPOWERSCALE 0.000745561F         // convert ADC reading squared to reverse watts
+#define VCURRENTSCALE 0.069225749F          // convert ADC reading to current (includes potential divider)
+#define VVOLTAGESCALE 0.076311849F          // convert ADC reading to PSU voltage
+
+
+//
+// fixed point conversion
+// the float scale factors above are turned into integer multipliers at compile time, so no
+// float maths is done at run time. Result = (ADC reading * MULT) >> SHIFT, giving 10x the value.
+// The multiplier/shift pairs were chosen so the result is identical to the float calculation
+// for every 10 bit ADC reading 0-1023.
+// Readings now have VADCFRACBITS extra bits of resolution from oversampling, so the shift is
+// increased to match.
+// Power is a square law, so it is held as a 1024 entry lookup table in flash for each direction,
+// generated at compile time from the same formula that used to be calculated every tick.
+// The extra resolution bits are used to interpolate between table entries.
+//
+#define VADCFRACBITS 3                                      // readings are 13 bit: (10 bit ADC value) x 8
+#define VADCFRACMASK ((1 << VADCFRACBITS) - 1)
+#define VADCMAXREADING (1023UL << VADCFRACBITS)             // largest 13 bit reading
+#define VCURRENTSHIFT 16
+#define VCURRENTMULT ((unsigned long)(VCURRENTSCALE * 10.0 * (1UL << VCURRENTSHIFT) + 0.5))
+#define VVOLTAGESHIFT 18
+#define VVOLTAGEMULT ((unsigned long)(VVOLTAGESCALE * 10.0 * (1UL << VVOLTAGESHIFT) + 0.5))
+
+static_assert(VCURRENTMULT <= 0xFFFFFFFFUL / VADCMAXREADING, "current product must fit 32 bits");
+static_assert(VVOLTAGEMULT <= 0xFFFFFFFFUL / VADCMAXREADING, "voltage product must fit 32 bits");
+
+constexpr int FwdPowerFromADC(int Reading)
+{
+  return (int)((float)Reading * (float)Reading * VFWDPOWERSCALE);
+}
+
+constexpr int RevPowerFromADC(int Reading)
+{
+  return (int)((float)Reading * (float)Reading * VREVPOWERSCALE);
+}
+
+//
+// macros to expand a constexpr function F into a table entry for every ADC reading 0-1023
+//
+#define VADCTABLE4(F, n) F(n), F(n+1), F(n+2), F(n+3)
+#define VADCTABLE16(F, n) VADCTABLE4(F, n), VADCTABLE4(F, n+4), VADCTABLE4(F, n+8), VADCTABLE4(F, n+12)
+#define VADCTABLE64(F, n) VADCTABLE16(F, n), VADCTABLE16(F, n+16), VADCTABLE16(F, n+32), VADCTABLE16(F, n+48)
+#define VADCTABLE256(F, n) VADCTABLE64(F, n), VADCTABLE64(F, n+64), VADCTABLE64(F, n+128), VADCTABLE64(F, n+192)
+#define VADCTABLE(F) VADCTABLE256(F, 0), VADCTABLE256(F, 256), VADCTABLE256(F, 512), VADCTABLE256(F, 768)
+
+constexpr int GFwdPowerTable[1024] PROGMEM = { VADCTABLE(FwdPowerFromADC) };
+constexpr int GRevPowerTable[1024] PROGMEM = { VADCTABLE(RevPowerFromADC) };
+
+
+//
+// thermistor calibration
+// the thermistor (10K at 25C, digikey 495-2163-ND) is the top half of a potential divider
+// with a 2K7 resistor to 0V, so its resistance is found from the ADC reading by:
+//    R = 2700 * (1024 - ADC) / ADC
+// the temperature is then found from the Steinhart-Hart equation:
+//    1/T = A + B.ln(R) + C.ln(R)^3      (T in Kelvin)
+// coefficients fitted to the R/R25 characteristic in the "temp sensor calculator" spreadsheet
+// at 0C, 70C and 140C. This is within 0.25C of every spreadsheet point from 0C to 155C.
+// to change thermistor type, just change the coefficients (and divider resistor if changed).
+//
+#define VTHERMA 1.13718015E-3F
+#define VTHERMB 2.30516107E-4F
+#define VTHERMC 1.18641457E-7F
+#define VTHERMDIVIDER 2700.0F               // divider resistor to 0V
+#define VTEMPMIN -200                       // -20C: reported for open circuit or very cold
+#define VTEMPMAX 1800                       // 180C: reported for short circuit or very hot
+
+//
+// Steinhart-Hart equation, given ln(R). Result is 1DP fixed point (ie 10x temp in C), not clipped.
+//
+constexpr float SteinhartHart(float LnR)
+{
+  return 10.0F * (1.0F / (VTHERMA + VTHERMB * LnR + VTHERMC * LnR * LnR * LnR) - 273.15F);
+}
+
+//
+// round and clip a 1DP temperature to the range the table can report
+//
+constexpr int ClipTemp(float Temp)
+{
+  return (Temp < VTEMPMIN) ? VTEMPMIN : ((Temp > VTEMPMAX) ? VTEMPMAX : (int)(Temp + ((Temp < 0) ? -0.5F : 0.5F)));
+}
+
+//
+// find the 1DP temperature for one ADC reading. 0 and 1023 are the open and short circuit extremes.
+//
+constexpr int TempFromADC(int Reading)
+{
+  return (Reading == 0) ? VTEMPMIN :
+         ((Reading >= 1023) ? VTEMPMAX : ClipTemp(SteinhartHart(log(VTHERMDIVIDER * (1024 - Reading) / Reading))));
+}
+
+//
+// lookup table in flash, with a temperature for every possible ADC reading
+// generated at compile time
+//
+constexpr int GTempTable[1024] PROGMEM = { VADCTABLE(TempFromADC) };
+
+
+//
+// SWR and return loss
+// reflection coefficient |gamma| = sqrt(Prev/Pfwd). To avoid a divide, forward power is normalised
+// to an 8 bit mantissa (128-255) and a shift; the ratio is then Prev x (2^22/mantissa), shifted,
+// giving Prev/Pfwd in Q16. Its integer square root is |gamma| in Q8, which indexes flash tables
+// of SWR and return loss generated at compile time.
+//
+#define VSWRMAX 9999                        // 99.99:1: reported for total reflection
+#define VRETURNLOSSMAX 999                  // 99.9dB: reported for no reflection
+#define VRECIPSHIFT 22                      // reciprocal table holds 2^22/mantissa
+
+//
+// reciprocal of an 8 bit normalised mantissa (128-255)
+//
+constexpr unsigned int RecipFromMantissa(int Mantissa)
+{
+  return (unsigned int)(((1UL << VRECIPSHIFT) + Mantissa/2) / Mantissa);
+}
+
+//
+// SWR x100 for |gamma| = Gamma/256
+//
+constexpr unsigned int SWRFromGamma(int Gamma)
+{
+  return (100.0F * (256 + Gamma) / (256 - Gamma) > VSWRMAX) ? VSWRMAX :
+         (unsigned int)(100.0F * (256 + Gamma) / (256 - Gamma) + 0.5F);
+}
+
+//
+// return loss x10 (dB) for |gamma| = Gamma/256
+//
+constexpr unsigned int ReturnLossFromGamma(int Gamma)
+{
+  return (Gamma == 0) ? VRETURNLOSSMAX :
+         ((-200.0F * log10(Gamma / 256.0F) > VRETURNLOSSMAX) ? VRETURNLOSSMAX :
+         (unsigned int)(-200.0F * log10(Gamma / 256.0F) + 0.5F));
+}
+
+constexpr unsigned int GRecipTable[128] PROGMEM = { VADCTABLE64(RecipFromMantissa, 128), VADCTABLE64(RecipFromMantissa, 192) };
+constexpr unsigned int GSWRTable[256] PROGMEM = { VADCTABLE256(SWRFromGamma, 0) };
+constexpr unsigned int GReturnLossTable[256] PROGMEM = { VADCTABLE256(ReturnLossFromGamma, 0) };
+
+
+//
+// look up a 13 bit reading in a 1024 entry flash table
+// the extra resolution bits interpolate between adjacent entries (a multiply but no divide)
+//
+inline int LookupADCTable(const int* Table, unsigned int Reading)
+{
+  unsigned int Index;
+  unsigned char Fraction;
+  int Value;
+
+  Index = Reading >> VADCFRACBITS;
+  Fraction = Reading & VADCFRACMASK;
+  Value = (int)pgm_read_word(&Table[Index]);
+  if (Fraction != 0)                                    // never true for the last table entry
+    Value += (((int)pgm_read_word(&Table[Index+1]) - Value) * Fraction) >> VADCFRACBITS;
+  return Value;
+}
+
+
+//
+// 10x drain current for a 13 bit reading with the zero offset already removed. Clips at 0A.
+//
+inline unsigned int CurrentFromADC(int Reading)
+{
+  unsigned int Current = 0;
+
+  if (Reading > 0)
+    Current = ((unsigned long)Reading * VCURRENTMULT) >> (VCURRENTSHIFT + VADCFRACBITS);
+  return Current;
+}
+
+
+//
+// 10x PSU voltage for a 13 bit reading
+//
+inline unsigned int VoltageFromADC(unsigned int Reading)
+{
+  return ((unsigned long)Reading * VVOLTAGEMULT) >> (VVOLTAGESHIFT + VADCFRACBITS);
+}
+
+
+#endif      // file sentry
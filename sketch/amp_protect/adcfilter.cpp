@@ -0,0 +1,58 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// adcfilter.cpp
+// this file holds the ADC reading filter stage (median then IIR low pass)
+// it has no Arduino dependencies, so it can also be built on a host (see test/)
+/////////////////////////////////////////////////////////////////////////
+
+#include "adcfilter.h"
+
+
+//
+// filter stage for one new reading: median then IIR
+//
+unsigned int ADCFilterStep(SADCFilter* Filter, unsigned char Median, unsigned char IIRShift, unsigned int Reading)
+{
+  unsigned int Sorted[VMAXMEDIAN];
+  unsigned int Value;
+  unsigned char Cntr, Pos;
+
+  if (!Filter->Primed)
+  {
+    for (Cntr = 0; Cntr < VMAXMEDIAN; Cntr++)
+      Filter->History[Cntr] = Reading;
+    Filter->IIRState = Reading << IIRShift;
+    Filter->Primed = true;
+  }
+//
+// median: add to history, then insertion sort a copy (at most 5 entries) and take the middle
+//
+  if (Median != 0)
+  {
+    Filter->History[Filter->Index] = Reading;
+    if (++Filter->Index >= Median)
+      Filter->Index = 0;
+    for (Cntr = 0; Cntr < Median; Cntr++)
+    {
+      Value = Filter->History[Cntr];
+      for (Pos = Cntr; (Pos != 0) && (Sorted[Pos-1] > Value); Pos--)
+        Sorted[Pos] = Sorted[Pos-1];
+      Sorted[Pos] = Value;
+    }
+    Reading = Sorted[Median >> 1];
+  }
+//
+// IIR: state max 8184 x 8, fits 16 bits
+//
+  if (IIRShift != 0)
+  {
+    Filter->IIRState += Reading - (Filter->IIRState >> IIRShift);
+    Reading = Filter->IIRState >> IIRShift;
+  }
+  return Reading;
+}
@@ -0,0 +1,51 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// adcfilter.h
+// this file holds the ADC reading filter stage (median then IIR low pass)
+// it has no Arduino dependencies, so it can also be built on a host (see test/)
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __ADCFILTER_H
+#define __ADCFILTER_H
+
+
+//
+// filter stage, applied each time a channel has a new (tick) reading, before it is consumed
+// so that the protection checks see the filtered value:
+//   median of the last 3 or 5 readings: rejects a glitch of 1 (or 2) readings.
+//      a step change is delayed by 1 (or 2) readings.
+//   single pole IIR low pass: y += (x - y) / 2^k, with the state held as y x 2^k so no resolution
+//      is lost. Time constant is 2^k readings (k = 1 to 3; 0 = no IIR).
+//      90% of a step is reached after 4 (k=1), 9 (k=2) or 18 (k=3) readings, and the output
+//      settles to exactly the input.
+//
+#define VMAXMEDIAN 5
+#define VMAXIIRSHIFT 3                      // state max 8184 x 8: fits 16 bits
+
+
+//
+// filter state for one channel. Zero it (eg as a global) before the first reading.
+//
+struct SADCFilter
+{
+  unsigned int History[VMAXMEDIAN];         // most recent readings for median filter
+  unsigned char Index;                      // next history slot to write
+  unsigned int IIRState;                    // IIR output x 2^k
+  bool Primed;                              // true after 1st reading has initialised the filter
+};
+
+
+//
+// filter one new 13 bit reading: median of Median readings (3 or 5; 0 = none) then IIR with
+// time constant 2^IIRShift readings (0 = none). Returns the filtered reading.
+// the first reading fills the median history and IIR state, so there is no start up transient
+//
+unsigned int ADCFilterStep(SADCFilter* Filter, unsigned char Median, unsigned char IIRShift, unsigned int Reading);
+
+
+#endif      // file sentry
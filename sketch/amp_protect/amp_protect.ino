@@ -19,29 +19,67 @@
 #include "iopins.h"
 #include "protect.h"
 #include "configdata.h"
+#include "eventlog.h"
+#include "eepromwriter.h"
+#include "thermal.h"
+#include "scheduler.h"
 
 
 //
 // global variables
 //
-bool GTickTriggered;                  // true if a 16ms tick has been triggered
-
 bool ledOn = false;                   // for heartbeat LED:
-byte Counter = 0;                     // for heartbeat LED:
+
+
+//
+// heartbeat LED: toggles every 0.5s; the on time is stepped on once per second
+//
+void HeartbeatTick(void)
+{
+  ledOn = !ledOn;
+  if (ledOn)
+  {
+    TimeSecondTick();
+    digitalWrite(LED_BUILTIN, HIGH); // Led on, off, on, off...
+  }
+  else
+    digitalWrite(LED_BUILTIN, LOW);
+}
+
+
+//
+// the task table, in ETask order
+// settings changes are applied first, so the rest of the tick sees one consistent set; then
+// analogue input and protection, every tick. Tasks at a slower rate are given 
+// phases so they don't all land on the same tick
+// function, period (ticks), phase (ticks), priority
+//
+const STask GTasks[VNUMTASKS] = 
+{
+  {ConfigTick, 1, 0, VPRIORITYPROTECT},                     // apply any settings changes between ticks
+  {AnalogueIOTick, 1, 0, VPRIORITYPROTECT},                 // get analogue values
+  {ProtectTick, 1, 0, VPRIORITYPROTECT},                    // update protection logic
+  {ThermalTick, 1, 0, VPRIORITYCONTROL},                    // thermal forecast and fan speed
+  {HeartbeatTick, 50, 25, VPRIORITYCONTROL},                // heartbeat LED
+  {ScanParseSerial, 1, 0, VPRIORITYCOMMS},                  // look for CAT commands and process them
+  {EEPROMWriterTick, 1, 0, VPRIORITYBACKGROUND},            // write behind queued settings or event log records
+  {DisplayTick, 1, 0, VPRIORITYBACKGROUND}                  // display update
+};
 
 
 //
 // counter clocked by CK/64 (4us)
+// the tick is on TCB2: TCB0 drives the fan PWM on its output pin (see thermal.cpp)
 //
 void SetupTimerForInterrupt(int Milliseconds)
 {
   int Count;
 
   Count = 250* Milliseconds;                // temp value - not sure why not 250!
-  TCB0.CTRLB = TCB_CNTMODE_INT_gc; // Use timer compare mode  
-  TCB0.CCMP = Count; // Value to compare with. This is 1/5th of the tick rate, so 5 Hz
-  TCB0.INTCTRL = TCB_CAPT_bm; // Enable the interrupt
-  TCB0.CTRLA = TCB_CLKSEL_CLKTCA_gc | TCB_ENABLE_bm; // Use Timer A as clock, enable timer
+  TCB2.CTRLB = TCB_CNTMODE_INT_gc; // Use timer compare mode  
+  TCB2.CCMP = Count; // Value to compare with. This is 1/5th of the tick rate, so 5 Hz
+  TCB2.INTCTRL = TCB_CAPT_bm; // Enable the interrupt
+  TCB2.CTRLA = TCB_CLKSEL_CLKTCA_gc | TCB_ENABLE_bm; // Use Timer A as clock, enable timer
 }
 
 
@@ -57,8 +95,10 @@ void setup()
   delay(1000);
   ConfigIOPins();
   LoadSettingsFromEEprom();
+  EventLogInit();
 
   AnalogueIOInit();
+  ThermalInit();
   DisplayInit();
   OnTimeInit();                                                   // initialise "on time" variables
 //
@@ -67,66 +107,30 @@ void setup()
   InitCAT();
 
   ProtectInit();
+  SchedulerInit();                                                // last: ticks during setup aren't missed ticks
 }
 
 
 //
 // periodic timer tick handler.
 //
-ISR(TCB0_INT_vect)
+ISR(TCB2_INT_vect)
 {
-  GTickTriggered = true;
+  noInterrupts();                   // the trip interrupt (level 1) reads both for its timestamp
+  GTickCount++;
    // Clear interrupt flag
-  TCB0.INTFLAGS = TCB_CAPT_bm;
+  TCB2.INTFLAGS = TCB_CAPT_bm;
+  interrupts();
 }
 
 
 
 //
-// sits and waits for time tick to have happened
+// run the scheduler: it runs the tasks due whenever a tick has happened
 //
 void loop() 
 {
-  while (GTickTriggered)
-  {
-    GTickTriggered = false;
-// heartbeat LED
-    if (Counter == 0)
-    {
-      Counter=49;
-      ledOn = !ledOn;
-      if (ledOn)
-      {
-        TimeSecondTick();
-        digitalWrite(LED_BUILTIN, HIGH); // Led on, off, on, off...
-      }
-       else
-        digitalWrite(LED_BUILTIN, LOW);
-    }
-    else
-      Counter--;
-//
-// get analogue values
-//
-    AnalogueIOTick();
-//
-// look for any CAT commands in the serial input buffer and process them
-//    
-    ScanParseSerial();
-
-//
-// update protection logic
-//
-    ProtectTick();
-
-//
-// display update
-//
-    
-    DisplayTick();
-
-  }
-
+  SchedulerRun();
 }
 
 
@@ -14,24 +14,19 @@
 #include "iopins.h"
 #include "analogueio.h"
 #include "protect.h"
+#include "sensorstats.h"
+#include "flightrecorder.h"
+#include "configdata.h"
+#include "adcconvert.h"
+#include "adcfilter.h"
 
 
 //
-// scaling factors to convert from ADC reading to sensed value
-// note these are for true ISO units, not scaled by a factor of 10 for 1 decimapl place
-// see spreadsheet for derivation
+// comparator threshold outputs. See spreadsheet for derivation.
 //
-#define VFWDPOWERSCALE 0.002968131F         // convert ADC reading squared to forward watts
-#define VREVPOWERSCALE 0.000745561F         // convert ADC reading squared to reverse watts
-#define VCURRENTSCALE 0.069225749F          // convert ADC reading to current (includes potential divider)
-#define VVOLTAGESCALE 0.076311849F          // convert ADC reading to PSU voltage
-
 //
-// comparator threshold outputs. See spreadsheet for derivation.
+// PWM comparator thresholds are tunable: see EConfigParam in configdata.h
 //
-#define VCURRENTPWMTHRESHOLD  163           // 45A true current  
-#define VVOLTAGEPWMTHRESHOLD  174           // 3.391V
-#define VREVPOWERPWMTHRESHOLD 177           // 3.46V
 
 
 //
@@ -44,78 +39,186 @@ unsigned int GSensorPSUVolts;             // 1DP
 unsigned int GSensorCurrent;              // 1DP
 unsigned int GSensorFwdPower;             // watts (not 1DP)
 unsigned int GSensorRevPower;             // watts (not 1DP)
-unsigned int GSensorFwdPowerPeak;
-unsigned int GSensorRevPowerPeak;
-int GSensorZeroCurrentRaw;               // ADC reading
+unsigned int GSensorSWR;                  // 2DP; 0 if forward power too low to measure
+unsigned int GSensorReturnLoss;           // 1DP dB; 0 if forward power too low to measure
+int GSensorZeroCurrentRaw;               // ADC reading (13 bit)
+
+//
+// zero current offset tracker
+// while there is no drain current (RX) every tick reading of the current channel is averaged
+// into the offset estimate by a long IIR (time constant 2^VZEROSHIFT ticks). Readings more than
+// VZEROREJECT from the estimate are rejected as outliers (eg the first tick of TX current).
+// If every reading is rejected for VZERORESEED ticks, the offset has genuinely moved so the 
+// estimate is re-seeded. The estimate is frozen while tracking is disabled (TX).
+//
+#define VZEROSHIFT 6                      // 64 ticks = 0.64s time constant
+#define VZEROREJECT 32                    // 13 bit counts: about 0.28A
+#define VZERORESEED 200                   // 2s of rejected readings
+bool GZeroTrackingEnabled;                // true if no drain current is expected
+long GZeroCurrentState;                   // offset estimate x 2^VZEROSHIFT
+byte GZeroRejectCount;                    // consecutive rejected readings
 
 //
-// interpolate temperature measurements
-// we have an array of point pairs fully covering the ADC input range, including 0 and 1023
+// published sensor values
+// the consumers above work on the GSensor variables; at the end of each tick a copy is published
+// to GSnapshot with a sequence counter (seqlock): the count is odd while the copy is being written.
+// Readers copy the snapshot and retry if the count was odd or changed, so they always get a 
+// coherent set of values without disabling interrupts.
 //
+volatile byte GSnapshotSequence;
+SSensorSnapshot GSnapshot;
+#define MEMORYBARRIER() asm volatile("" ::: "memory")   // stop the compiler moving memory accesses across this
+
 
-struct STempData
+//
+// free running ADC sampler
+// the ADC0 result ready interrupt stores each conversion into a per channel ring buffer,
+// then selects the next channel and starts its conversion. The channels are scanned continuously
+// and AnalogueIOTick() consumes whatever has accumulated since the last tick.
+//
+// oversampling: each channel can have the ADC hardware accumulate 2^n conversions (SAMPNUM)
+// into one result, so it costs no extra CPU time. Accumulating 4^k samples and dividing by 2^k 
+// adds k bits of resolution: ACC16 gives 12 bits, ACC64 gives 13 bits. The ISR decimates 
+// every result to the same 13 bit scale (10 bit reading x 8) whatever the oversample ratio.
+//
+// scheduling: each channel is only converted on every <Period>th scan, so the ADC time goes to
+// the channels that can change quickly. The ADC clock is 1MHz (16MHz/16) so one conversion 
+// takes 15us. With the table below a scan of the fast channels takes 270us, and the slow 
+// channels add 480us every 32nd scan: the fast channels are read at about 3.5KHz, the slow ones
+// about every 9ms.
+//
+#define VNUMADCCHANNELS 5
+#define VADCRINGSIZE 64                 // samples per channel: must be a power of 2. Holds nearly 2 ticks' worth
+#define VADCRINGMASK (VADCRINGSIZE-1)
+
+enum EADCChannel
 {
-  int ADCPoint;
-  int Temp;
+  eADCCurrent,                          // drain current
+  eADCFwdPower,                         // forward RF voltage
+  eADCRevPower,                         // reverse RF voltage
+  eADCTemperature,                      // heatsink thermistor
+  eADCVoltage                           // PSU voltage
 };
 
 
+//
+// how the tick reduces the samples accumulated since the last tick to one reading
+//
+enum EADCFilter
+{
+  eFilterMean,                          // average: for noise reduction
+  eFilterPeak                           // maximum: so short excursions are seen
+};
+
+
+//
+// filter stage (see adcfilter.h), applied each time a channel has a new (tick) reading, before
+// it is consumed so that the protection checks see the filtered value.
+// readings are once per tick (10ms) for the fast channels, about every 9ms for the slow ones.
+// per channel latency to 90% of a step is given in the table below (checked by test/adcfilter_test.cpp).
+//
+
+
+//
+// consumers: convert a 13 bit reading to a sensor value and store it
+//
+void ConsumeCurrent(unsigned int Reading);
+void ConsumeFwdPower(unsigned int Reading);
+void ConsumeRevPower(unsigned int Reading);
+void ConsumeTemperature(unsigned int Reading);
+void ConsumeVoltage(unsigned int Reading);
+
 
 //
-// lookup data for thermistor calibration
-// derived from a spreadsheet
+// this struct describes the sampling of one channel
 //
-#define VNUMTEMPDATAPOINTS 11
-STempData GTempDataArray[VNUMTEMPDATAPOINTS] =
+struct SADCChannel
 {
-  {0,-200},
-  {100, 50},
-  {182, 200},
-  {298, 350},
-  {435, 500},
-  {573, 650},
-  {693, 800},
-  {814, 1000},
-  {906, 1250},
-  {949, 1450},
-  {1023,1800}
+  byte Pin;                             // analogue input pin
+  byte SampNum;                         // oversample ratio (ADC SAMPNUM setting)
+  byte Period;                          // converted every <Period> scans. Must be a power of 2
+  EADCFilter Filter;                    // how samples are reduced each tick
+  byte Median;                          // median of 3 or 5 readings (0 = no median)
+  byte IIRShift;                        // IIR time constant 2^k readings (0 = no IIR)
+  void (*Consumer)(unsigned int);       // function to convert and store the reading
 };
 
 
+//
+// channel scheduler table. This must exactly match the enum EADCChannel.
+// Power is not oversampled so that peaks are not averaged out.
+// At least one channel must have period 1.
+//
+const SADCChannel GADCChannels[VNUMADCCHANNELS] = 
+{
+  {VPINCURRENTADC, ADC_SAMPNUM_ACC16_gc, 1, eFilterMean, 0, 0, ConsumeCurrent},       // 12 bits; latency 10ms
+  {VPINFWDPOWERADC, ADC_SAMPNUM_ACC1_gc, 1, eFilterPeak, 3, 0, ConsumeFwdPower},      // 10 bits; latency 20ms
+  {VPINREVPOWERADC, ADC_SAMPNUM_ACC1_gc, 1, eFilterPeak, 3, 0, ConsumeRevPower},      // 10 bits; latency 20ms
+  {VPINTEMPADC, ADC_SAMPNUM_ACC16_gc, 32, eFilterMean, 5, 3, ConsumeTemperature},     // 12 bits; latency 200ms
+  {VPINVOLTAGEADC, ADC_SAMPNUM_ACC16_gc, 32, eFilterMean, 3, 2, ConsumeVoltage}       // 12 bits; latency 100ms
+};
+
+byte GADCMuxPos[VNUMADCCHANNELS];                           // MUXPOS register value for each channel
+byte GADCSampNum[VNUMADCCHANNELS];                          // CTRLB register value for each channel
+byte GADCPeriodMask[VNUMADCCHANNELS];                       // (period-1): channel converted if (scan & mask)==0
+signed char GADCShift[VNUMADCCHANNELS];                     // left shift to decimate to 13 bits (-ve = right shift)
+volatile unsigned int GADCRing[VNUMADCCHANNELS][VADCRINGSIZE];  // raw samples written by the ISR
+volatile byte GADCRingHead[VNUMADCCHANNELS];                // free running write count, written by ISR only
+byte GADCRingTail[VNUMADCCHANNELS];                         // free running read count, written by tick only
+volatile byte GADCChannel;                                  // channel being converted
+volatile byte GADCScan;                                     // scan count
+unsigned int GADCReading[VNUMADCCHANNELS];                  // filtered reading from last tick
+SADCFilter GADCFilter[VNUMADCCHANNELS];                     // filter stage state
+
 
 //
-// find a temperature for a given ADC reading
-// this needs to read the table and find the points either side of the ADC reading
+// find a temperature for a given ADC reading (13 bit)
 // result is 1DP fixed point (ie integer, 10x temp value in C)
 //
-
 int FindTemp(int SensorReading)
 {
-  byte Index;    // array index
-  int FoundTemp;
-  int Temp1, Temp2; // temps above and below the data point
-  int ADC1, ADC2;       // ADC samples above and below the data point
-  int DeltaTemp;
-// check the extremes; if not an extreme, find points either side in the array
-  if (SensorReading == 0)
-    FoundTemp = GTempDataArray[0].Temp;
-  else if (SensorReading == 1023)
-    FoundTemp = GTempDataArray[VNUMTEMPDATAPOINTS -1].Temp;
-  else          // find points and interpolate
+  return LookupADCTable(GTempTable, SensorReading);
+}
+
+
+
+//
+// calculate SWR and return loss from the latest forward and reverse power
+// forward power below the gate threshold is too low to give a meaningful ratio: both read 0
+//
+void CalculateSWR(void)
+{
+  unsigned int Mantissa;
+  int Shift = 6;                                        // ratio = (Prev x recip) >> (22 - 16)
+  unsigned long Ratio;
+  byte Gamma;
+
+  GSensorSWR = 0;
+  GSensorReturnLoss = 0;
+  if ((GSensorFwdPower != 0) && (GSensorFwdPower >= (unsigned int)GConfig.Param[eParamSWRGate]))
   {
-    for(Index=1; Index < VNUMTEMPDATAPOINTS; Index++)
-      if(SensorReading < GTempDataArray[Index].ADCPoint)    // this will happen once!
-      { 
-        Temp2 = GTempDataArray[Index].Temp;
-        Temp1 = GTempDataArray[Index-1].Temp;
-        ADC2 = GTempDataArray[Index].ADCPoint;
-        ADC1 = GTempDataArray[Index-1].ADCPoint;
-        DeltaTemp = (Temp2-Temp1)*((128*(SensorReading-ADC1))/(ADC2-ADC1));
-        FoundTemp = Temp1 + (DeltaTemp >> 7);
-        break;
-      }
+    Mantissa = GSensorFwdPower;
+    while (Mantissa > 255)
+    {
+      Mantissa >>= 1;
+      Shift++;
+    }
+    while (Mantissa < 128)
+    {
+      Mantissa <<= 1;
+      Shift--;
+    }
+    Ratio = (unsigned long)GSensorRevPower * pgm_read_word(&GRecipTable[Mantissa - 128]);
+    if (Shift >= 0)
+      Ratio >>= Shift;
+    else
+      Ratio <<= -Shift;                                 // only if gate set below 64W: can't overflow
+    if (Ratio > 0xFFFF)                                 // reverse >= forward: clip at total reflection
+      Ratio = 0xFFFF;
+    Gamma = (byte)IntSqrt(Ratio);
+    GSensorSWR = pgm_read_word(&GSWRTable[Gamma]);
+    GSensorReturnLoss = pgm_read_word(&GReturnLossTable[Gamma]);
   }
-  return FoundTemp;
 }
 
 
@@ -133,67 +236,278 @@ void SetPWMThresholds(bool SetToMax)
   }
   else
   {
-    analogWrite(VPINCURRENTPWM, VCURRENTPWMTHRESHOLD);
-    analogWrite(VPINVOLTAGEPWM, VVOLTAGEPWMTHRESHOLD);
-    analogWrite(VPINREVPOWERPWM, VREVPOWERPWMTHRESHOLD);
+    analogWrite(VPINCURRENTPWM, GConfig.Param[eParamCurrentPWM]);
+    analogWrite(VPINVOLTAGEPWM, GConfig.Param[eParamVoltagePWM]);
+    analogWrite(VPINREVPOWERPWM, GConfig.Param[eParamRevPowerPWM]);
   }
 }
 
 
+//
+// ADC result ready interrupt
+// store the result (reading RES clears the interrupt flag) then start the next channel that is due
+// the scan count is only advanced when wrapping back to the first channel
+//
+ISR(ADC0_RESRDY_vect)
+{
+  byte Channel;
+  byte Head;
+  byte Scan;
+  signed char Shift;
+  unsigned int Result;
+
+  Channel = GADCChannel;
+  Result = ADC0.RES;
+  Shift = GADCShift[Channel];
+  if (Shift >= 0)                                         // decimate to 13 bits
+    Result <<= Shift;
+  else
+    Result >>= -Shift;
+  Head = GADCRingHead[Channel];
+  GADCRing[Channel][Head & VADCRINGMASK] = Result;
+  GADCRingHead[Channel] = Head + 1;
+  FlightRecorderSample(Channel, Result);
+
+  Scan = GADCScan;
+  do
+  {
+    if (++Channel >= VNUMADCCHANNELS)
+    {
+      Channel = 0;
+      Scan++;
+    }
+  } while ((Scan & GADCPeriodMask[Channel]) != 0);
+  GADCScan = Scan;
+  GADCChannel = Channel;
+  ADC0.MUXPOS = GADCMuxPos[Channel];
+  ADC0.CTRLB = GADCSampNum[Channel];
+  ADC0.COMMAND = ADC_STCONV_bm;
+}
+
+
+
+//
+// filter stage for one new reading: median then IIR, as set in the channel table
+//
+unsigned int FilterADCReading(byte Channel, unsigned int Reading)
+{
+  const SADCChannel* ChannelPtr;
+
+  ChannelPtr = GADCChannels + Channel;
+  return ADCFilterStep(GADCFilter + Channel, ChannelPtr->Median, ChannelPtr->IIRShift, Reading);
+}
+
+
+
+//
+// consume the samples accumulated for one channel since the last tick
+// reduces the new samples to one reading using the channel's tick filter, then passes it through
+// the filter stage; if there are no new samples, the previous reading is kept.
+// if the tick has been delayed so the ring overflowed, only the most recent samples are used
+// (one slot is left spare, because the ISR could be writing it)
+//
+void ConsumeADCSamples(byte Channel)
+{
+  unsigned int Reading;
+  byte Head;
+  byte Count;
+  byte Tail;
+  unsigned int Sample;
+  unsigned long Sum = 0;                                  // max 63 x 8184: needs 32 bits
+  unsigned int Peak = 0;
+
+  Head = GADCRingHead[Channel];                           // byte read is atomic
+  Count = Head - GADCRingTail[Channel];
+  if (Count > (VADCRINGSIZE - 1))
+    Count = VADCRINGSIZE - 1;
+  if (Count != 0)
+  {
+    for (Tail = Head - Count; Tail != Head; Tail++)
+    {
+      Sample = GADCRing[Channel][Tail & VADCRINGMASK];
+      Sum += Sample;
+      if (Sample > Peak)
+        Peak = Sample;
+    }
+    if (GADCChannels[Channel].Filter == eFilterPeak)
+      Reading = Peak;
+    else
+      Reading = Sum / Count;
+    GADCReading[Channel] = FilterADCReading(Channel, Reading);
+  }
+  GADCRingTail[Channel] = Head;
+}
+
+
+
 //
 // AnalogueIO initialise
-// set the comparator threshold values
+// set the comparator threshold values, then start the ADC scanning
+// the core has already set up the ADC reference for analogRead(); the clock is changed to 1MHz
+// note analogRead() must not be used after this, as the ISR owns the ADC
 //
 void AnalogueIOInit(void)
 {
+  byte Channel;
+  const SADCChannel* ChannelPtr;
+
   SetPWMThresholds(false);
-}
+  StatsInit();
+  for (Channel = 0; Channel < VNUMADCCHANNELS; Channel++)
+  {
+    ChannelPtr = GADCChannels + Channel;
+    GADCMuxPos[Channel] = digitalPinToAnalogInput(ChannelPtr->Pin) << ADC_MUXPOS_gp;
+    GADCSampNum[Channel] = ChannelPtr->SampNum;
+    GADCPeriodMask[Channel] = ChannelPtr->Period - 1;
+    GADCShift[Channel] = VADCFRACBITS - (ChannelPtr->SampNum & ADC_SAMPNUM_gm);
+  }
 
+  ADC0.CTRLC = (ADC0.CTRLC & ~ADC_PRESC_gm) | ADC_PRESC_DIV16_gc | ADC_SAMPCAP_bm;
+  GADCChannel = 0;
+  GADCScan = 0;
+  ADC0.MUXPOS = GADCMuxPos[0];
+  ADC0.CTRLB = GADCSampNum[0];
+  ADC0.INTFLAGS = ADC_RESRDY_bm;                          // clear any old result
+  ADC0.INTCTRL = ADC_RESRDY_bm;
+  ADC0.COMMAND = ADC_STCONV_bm;
+}
 
 
 
 //
-// AnalogueIO tick
-// read the aDC values
+// consumer for drain current
+// current needs to have the zero offset removed, but noise could make it dip below 0A. Clip at 0A.
 //
-void AnalogueIOTick(void)
+void ConsumeCurrent(unsigned int Reading)
 {
   int SensorReading;
-  float ScaledReading;
+
+  if (GZeroTrackingEnabled)
+  {
+    SensorReading = Reading - GSensorZeroCurrentRaw;
+    if ((SensorReading > VZEROREJECT) || (SensorReading < -VZEROREJECT))
+    {
+      if (++GZeroRejectCount >= VZERORESEED)                         // been rejected too long: re-seed
+      {
+        GZeroCurrentState = (long)Reading << VZEROSHIFT;
+        GZeroRejectCount = 0;
+      }
+    }
+    else
+    {
+      GZeroCurrentState += SensorReading;                           // state += (reading - state/2^n)
+      GZeroRejectCount = 0;
+    }
+    GSensorZeroCurrentRaw = GZeroCurrentState >> VZEROSHIFT;
+  }
+
+  SensorReading = Reading - GSensorZeroCurrentRaw;                  // ADC reading for current, less offset
+  GSensorCurrent = CurrentFromADC(SensorReading);                   // store 10x current to variable
+}
+
 
 //
-// current needs to have the zero offset removed, but noise could make it dip below 0A. Clip at 0A.
+// consumer for forward power
 //
-  SensorReading = analogRead(VPINCURRENTADC);                       // get ADC reading for current
-  ScaledReading = (float)(SensorReading - GSensorZeroCurrentRaw) * VCURRENTSCALE * 10.0;      // 10x current
-  if(ScaledReading > 0)
-    GSensorCurrent = (unsigned int)ScaledReading;                   // store 10x current to variable
-  else
-    GSensorCurrent = 0;
-    
-  SensorReading = analogRead(VPINTEMPADC);                          // get ADC reading for temperature
-  GSensorTemperature = (unsigned int)FindTemp(SensorReading);       // store 10x temp to variable
-
-  SensorReading = analogRead(VPINVOLTAGEADC);                       // get ADC reading for PSU voltage
-  ScaledReading = (float)SensorReading * VVOLTAGESCALE * 10.0;      // 10x voltage
-  GSensorPSUVolts = (unsigned int)ScaledReading;                    // store 10x voltage to variable
-
-  SensorReading = analogRead(VPINFWDPOWERADC);                      // get ADC reading for forward RF voltage
-  ScaledReading = (float)SensorReading;                             // ADC
-  ScaledReading = ScaledReading * ScaledReading * VFWDPOWERSCALE;   // V2/R for power
-  GSensorFwdPower = (unsigned int)ScaledReading;                    // store forward power to variable (not fixed point!)
-  if(GSensorFwdPower > GSensorFwdPowerPeak)                         // peak hold the value
-    GSensorFwdPowerPeak = GSensorFwdPower;
-    
-  SensorReading = analogRead(VPINREVPOWERADC);                      // get ADC reading for reverse RF voltage
-  ScaledReading = (float)SensorReading;                             // ADC
-  ScaledReading = ScaledReading * ScaledReading * VREVPOWERSCALE;   // V2/R for power
-  GSensorRevPower = (unsigned int)ScaledReading;                    // store reverse power to variable (not fixed point!)
-  if(GSensorRevPower > GSensorRevPowerPeak)
-    GSensorRevPowerPeak = GSensorRevPower;
-
-  CheckTemperature(GSensorTemperature);
-  CheckFwdPower(GSensorFwdPower);
+void ConsumeFwdPower(unsigned int Reading)
+{
+  GSensorFwdPower = LookupADCTable(GFwdPowerTable, Reading);        // store forward power to variable (not fixed point!)
+}
+
+
+//
+// consumer for reverse power
+//
+void ConsumeRevPower(unsigned int Reading)
+{
+  GSensorRevPower = LookupADCTable(GRevPowerTable, Reading);        // store reverse power to variable (not fixed point!)
+}
+
+
+//
+// consumer for heatsink temperature
+//
+void ConsumeTemperature(unsigned int Reading)
+{
+  GSensorTemperature = (unsigned int)FindTemp(Reading);             // store 10x temp to variable
+}
+
+
+//
+// consumer for PSU voltage
+//
+void ConsumeVoltage(unsigned int Reading)
+{
+  GSensorPSUVolts = VoltageFromADC(Reading);                        // store 10x voltage to variable
+}
+
+
+
+
+//
+// publish the sensor values as a new snapshot
+//
+void PublishSensorSnapshot(void)
+{
+  GSnapshotSequence++;                                    // odd: write in progress
+  MEMORYBARRIER();
+  GSnapshot.Timestamp = millis();
+  GSnapshot.Temperature = GSensorTemperature;
+  GSnapshot.PSUVolts = GSensorPSUVolts;
+  GSnapshot.Current = GSensorCurrent;
+  GSnapshot.FwdPower = GSensorFwdPower;
+  GSnapshot.RevPower = GSensorRevPower;
+  GSnapshot.SWR = GSensorSWR;
+  GSnapshot.ReturnLoss = GSensorReturnLoss;
+  MEMORYBARRIER();
+  GSnapshotSequence++;                                    // even: complete
+}
+
+
+
+//
+// get a coherent copy of the latest sensor values
+// must not be called from an ISR (it could interrupt the publisher and wait forever)
+//
+void GetSensorSnapshot(SSensorSnapshot* Snapshot)
+{
+  byte Sequence;
+
+  do
+  {
+    do
+      Sequence = GSnapshotSequence;
+    while (Sequence & 1);
+    MEMORYBARRIER();
+    *Snapshot = GSnapshot;
+    MEMORYBARRIER();
+  } while (Sequence != GSnapshotSequence);
+}
+
+
+
+
+//
+// AnalogueIO tick
+// process the ADC values accumulated since the last tick through each channel's filter and consumer
+// then publish them, and add them to the rolling statistics
+//
+void AnalogueIOTick(void)
+{
+  byte Channel;
+
+  for (Channel = 0; Channel < VNUMADCCHANNELS; Channel++)
+  {
+    ConsumeADCSamples(Channel);
+    GADCChannels[Channel].Consumer(GADCReading[Channel]);
+  }
+  CalculateSWR();
+  PublishSensorSnapshot();
+  AddStatsSample(eStatsTemperature, GSensorTemperature);
+  AddStatsSample(eStatsPSUVolts, GSensorPSUVolts);
+  AddStatsSample(eStatsCurrent, GSensorCurrent);
+  AddStatsSample(eStatsFwdPower, GSensorFwdPower);
+  AddStatsSample(eStatsRevPower, GSensorRevPower);
 }
 
 
@@ -202,7 +516,10 @@ void AnalogueIOTick(void)
 //
 int GetTemperature(void)
 {
-  return GSensorTemperature;
+  SSensorSnapshot Snapshot;
+
+  GetSensorSnapshot(&Snapshot);
+  return Snapshot.Temperature;
 }
 
 
@@ -211,7 +528,10 @@ int GetTemperature(void)
 //
 unsigned int GetPSUVoltage(void)
 {
-  return GSensorPSUVolts;
+  SSensorSnapshot Snapshot;
+
+  GetSensorSnapshot(&Snapshot);
+  return Snapshot.PSUVolts;
 }
 
 
@@ -220,7 +540,10 @@ unsigned int GetPSUVoltage(void)
 //
 unsigned int GetCurrent(void)
 {
-  return GSensorCurrent;
+  SSensorSnapshot Snapshot;
+
+  GetSensorSnapshot(&Snapshot);
+  return Snapshot.Current;
 }
 
 //
@@ -228,7 +551,10 @@ unsigned int GetCurrent(void)
 //
 unsigned int GetForwardPower(void)
 {
-  return GSensorFwdPower;
+  SSensorSnapshot Snapshot;
+
+  GetSensorSnapshot(&Snapshot);
+  return Snapshot.FwdPower;
 }
 
 //
@@ -236,56 +562,64 @@ unsigned int GetForwardPower(void)
 //
 unsigned int GetReversePower(void)
 {
-  return GSensorRevPower;
+  SSensorSnapshot Snapshot;
+
+  GetSensorSnapshot(&Snapshot);
+  return Snapshot.RevPower;
 }
 
 
 //
-// get forward peak power, as integer
+// get SWR, as 2dp fixed point integer (ie 150 = 1.50:1)
+// returns 0 if the forward power is below the SWR gate threshold
 //
-unsigned int GetForwardPeakPower(bool Clear)
+unsigned int GetSWR(void)
 {
-  unsigned int Value;
+  SSensorSnapshot Snapshot;
 
-  Value = GSensorFwdPowerPeak; 
-  if(Clear)
-    GSensorFwdPowerPeak = 0;
-  return Value;
+  GetSensorSnapshot(&Snapshot);
+  return Snapshot.SWR;
 }
 
+
 //
-// get reverse power, as integer
+// get return loss, as 1dp fixed point integer dB
+// returns 0 if the forward power is below the SWR gate threshold
 //
-unsigned int GetReversePeakPower(bool Clear)
+unsigned int GetReturnLoss(void)
 {
-  unsigned int Value;
+  SSensorSnapshot Snapshot;
 
-  Value = GSensorRevPowerPeak; 
-  if(Clear)
-    GSensorRevPowerPeak = 0;
-  return Value;  
+  GetSensorSnapshot(&Snapshot);
+  return Snapshot.ReturnLoss;
 }
 
 
 //
-// clear peak hold settings. Called when PTT pressed
+// set zero current
+// this is used to null out offset current: the ACS723 has a delivberate offset
+// must be called when the current is zero!
+// this averages the whole current ring without consuming it, so it can be called before the 
+// first tick. It seeds the background tracker, which then refines the estimate.
 //
-void ClearPeakHolds(void)
+void SetZeroCurrent(void)
 {
-    GSensorRevPowerPeak = 0;
-    GSensorFwdPowerPeak = 0;  
+  byte Cntr;
+  unsigned long Sum = 0;
+
+  for (Cntr = 0; Cntr < VADCRINGSIZE; Cntr++)
+    Sum += GADCRing[eADCCurrent][Cntr];
+  GSensorZeroCurrentRaw = Sum / VADCRINGSIZE;
+  GZeroCurrentState = (long)GSensorZeroCurrentRaw << VZEROSHIFT;
+  GZeroRejectCount = 0;
 }
 
 
 //
-// set zero current
-// this is used to null out offset current: the ACS723 has a delivberate offset
-// must be called when the current is zero!
+// enable or disable background tracking of the zero current offset
+// must only be enabled when there is no drain current; the estimate is frozen when disabled
 //
-void SetZeroCurrent(void)
+void SetZeroCurrentTracking(bool Enabled)
 {
-  int SensorReading;
-  float ScaledReading;
-
-  GSensorZeroCurrentRaw = analogRead(VPINCURRENTADC);                       // get ADC reading for current
+  GZeroTrackingEnabled = Enabled;
 }
@@ -13,6 +13,22 @@
 #define __ANALOGUEIO_H
 
 
+//
+// a coherent set of sensor values, all published at the same tick
+//
+struct SSensorSnapshot
+{
+  unsigned long Timestamp;                  // millis() when published
+  int Temperature;                          // 1DP
+  unsigned int PSUVolts;                    // 1DP
+  unsigned int Current;                     // 1DP
+  unsigned int FwdPower;                    // watts (not 1DP)
+  unsigned int RevPower;                    // watts (not 1DP)
+  unsigned int SWR;                         // 2DP; 0 if forward power below the gate
+  unsigned int ReturnLoss;                  // 1DP dB; 0 if forward power below the gate
+};
+
+
 
 //
 // AnalogueIO tick
@@ -30,6 +46,13 @@ void AnalogueIOInit(void);
 
 
 
+//
+// get a coherent copy of the latest sensor values
+// must not be called from an ISR
+//
+void GetSensorSnapshot(SSensorSnapshot* Snapshot);
+
+
 //
 // get temperature, as 1 dp fixed point integer
 //
@@ -62,20 +85,19 @@ unsigned int GetForwardPower(void);
 //
 unsigned int GetReversePower(void);
 
-//
-// get forward peak power, as integer
-//
-unsigned int GetForwardPeakPower(bool Clear);
 
 //
-// get reverse power, as integer
+// get SWR, as 2dp fixed point integer (ie 150 = 1.50:1)
+// returns 0 if the forward power is below the SWR gate threshold
 //
-unsigned int GetReversePeakPower(bool Clear);
+unsigned int GetSWR(void);
+
 
 //
-// clear peak hold settings. Called when PTT pressed
+// get return loss, as 1dp fixed point integer dB
+// returns 0 if the forward power is below the SWR gate threshold
 //
-void ClearPeakHolds(void);
+unsigned int GetReturnLoss(void);
 
 
 //
@@ -85,6 +107,13 @@ void ClearPeakHolds(void);
 void SetZeroCurrent(void);
 
 
+//
+// enable or disable background tracking of the zero current offset
+// must only be enabled when there is no drain current; the estimate is frozen when disabled
+//
+void SetZeroCurrentTracking(bool Enabled);
+
+
 //
 // set PWM comparamtor thresholds
 // if paramter is true, set to max allowed (5V)
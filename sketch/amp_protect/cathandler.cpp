@@ -13,6 +13,14 @@
 
 #include "globalinclude.h"
 #include "cathandler.h"
+#include "sensorstats.h"
+#include "triplatency.h"
+#include "flightrecorder.h"
+#include "eventlog.h"
+#include "configdata.h"
+#include "analogueio.h"
+#include "thermal.h"
+#include "taskprofile.h"
 #include <stdlib.h>
 
 
@@ -62,28 +70,14 @@ void MakeSoftwareVersionMessage(void)
 // 16: high forward power trip
 // 64: can be reset
 //
-void MakeAmplifierTripMessage(ETripCause Data, bool CanReset)
+void MakeAmplifierTripMessage(byte TripMask, bool CanReset)
 {
   byte Value;
 
   if(CanReset)
     Value = 64;
   else 
-    switch(Data)
-    {
-      case eNoTrip:                              // not tripped
-        Value = 0; break;
-      case eTripCurrent:                         // excess current
-        Value = 2; break;
-      case eTripPSUVoltage:                      // input PSU over threshold
-        Value = 4; break;
-      case eTripTemperature:                     // temp outside limits
-        Value = 8; break;
-      case eTripFwdPower:                        // excessive forward power
-        Value = 16; break;
-      case eTripRevPower:                        // excessive reverse power
-        Value = 1; break;
-    }
+    Value = TripMask;
   
   MakeCATMessageNumeric(eZZZA,Value);
 }
@@ -124,6 +118,307 @@ HandleIncomingSWVersion(long Param)
 }
 
 
+//
+// handle a sensor statistics request, and send back the result
+// ZZZMcwf; requests statistic f (0=min, 1=max, 2=mean, 3=RMS) over window w (0=100ms, 1=1s, 2=10s)
+// for channel c (0=temperature, 1=PSU voltage, 2=current, 3=forward power, 4=reverse power)
+// reply is ZZZMcwfvvvvv; value is 1DP for temperature, voltage and current; watts for power.
+// negative values are sent as 0. RMS is only kept for the 100ms window: other RMS requests get no reply.
+//
+void HandleStatisticsMessage(long Param)
+{
+  byte Channel, Window, Function;
+  int Value;
+
+  Channel = Param / 100;
+  Window = (Param / 10) % 10;
+  Function = Param % 10;
+  if ((Param < 1000) && (Channel < VNUMSTATSCHANNELS) && (Window < VNUMSTATSWINDOWS) && (Function <= eStatsRMS) &&
+      ((Function != eStatsRMS) || (Window == eStatsWindow100ms)))
+  {
+    Value = GetStatistic((EStatsChannel)Channel, (EStatsWindow)Window, (EStatsFunction)Function);
+    if (Value < 0)
+      Value = 0;
+    MakeCATMessageNumeric(eZZZM, (Param * 100000L) + Value);
+  }
+}
+
+
+//
+// handle trip latency request message
+// ZZZLpss; requests statistic ss for hardware trip path p (0=current, 1=PSU voltage, 2=reverse power)
+// ss: 00=count, 01=min, 02=max, 03=last (0.1us units); 10-15 = histogram bin (<1us, 1-2us ... >=16us)
+// reply is ZZZLpssvvvvvv;
+// ZZZL999; clears all latency statistics (999 is not a valid path and statistic)
+// if the sketch was built without VTIMETRIPLATENCY (see triplatency.h) nothing is timed, so
+// every request gets the reply ZZZL999999999; (not compiled in) instead of a zero count
+//
+#define VLATENCYCLEAR 999                   // ZZZL selector to clear the statistics
+#define VLATENCYNOTBUILT 999999999L         // ZZZL reply if latency timing not compiled in
+
+void HandleTripLatencyMessage(long Param)
+{
+#ifdef VTIMETRIPLATENCY
+  byte Path, Stat;
+  unsigned long Value;
+  bool ValidRequest = true;
+
+  if (Param == VLATENCYCLEAR)
+    ClearTripLatency();
+  else
+  {
+    Path = Param / 100;
+    Stat = Param % 100;
+    if ((Param < 1000) && (Path < VNUMLATENCYPATHS))
+    {
+      if (Stat <= eLatencyLast)
+        Value = GetTripLatency((ELatencyPath)Path, (ELatencyStat)Stat, 0);
+      else if ((Stat >= 10) && (Stat < (10 + VLATENCYBINS)))
+        Value = GetTripLatency((ELatencyPath)Path, eLatencyHistogram, Stat - 10);
+      else
+        ValidRequest = false;
+      if (ValidRequest)
+      {
+        if (Value > 999999)
+          Value = 999999;
+        MakeCATMessageNumeric(eZZZL, (Param * 1000000L) + Value);
+      }
+    }
+  }
+#else
+  MakeCATMessageNumeric(eZZZL, VLATENCYNOTBUILT);
+#endif
+}
+
+
+//
+// send the trip cause message
+// ZZZT; reply is ZZZT00000ffmm (9 digits); ff = first cause to trip, mm = mask of all
+// latched causes (both using the ZZZA bit encoding)
+//
+void MakeTripCauseMessage(void)
+{
+  MakeCATMessageNumeric(eZZZT, (TripCauseBit(GTripCause) * 100L) + GTripMask);
+}
+
+
+//
+// handle trip cause timestamp request
+// ZZZTnn; requests the time that cause nn (ZZZA bit encoding) tripped, relative to the first cause
+// reply is ZZZTnnttttttt (9 digits); time in microseconds, or 9999999 if that cause has not tripped
+//
+void HandleTripTimeMessage(long Param)
+{
+  byte Cause;
+  unsigned long Time = 9999999;
+
+  for (Cause = eTripCurrent; Cause <= eTripRevPower; Cause++)
+    if (TripCauseBit((ETripCause)Cause) == Param)
+    {
+      if (GTripMask & Param)
+      {
+        Time = GetTripTime((ETripCause)Cause) - GetTripTime(GTripCause);
+        if (Time > 9999999)
+          Time = 9999999;
+      }
+      MakeCATMessageNumeric(eZZZT, (Param * 10000000L) + Time);
+    }
+}
+
+
+//
+// helper to append a number as a fixed number of upper case hex digits
+//
+void AppendHex(char* Str, unsigned int Value, byte Digits)
+{
+  char* Ptr;
+  byte Nibble;
+
+  Ptr = Str + strlen(Str) + Digits;
+  *Ptr-- = 0;
+  while (Digits--)
+  {
+    Nibble = Value & 0x0F;
+    *Ptr-- = (Nibble < 10) ? ('0' + Nibble) : ('A' + Nibble - 10);
+    Value >>= 4;
+  }
+}
+
+
+//
+// send the flight recorder status
+// reply is ZZZR999ssccttmm; all hex: ss = state (0 armed, 1 triggered, 2 frozen)
+// cc = valid entries, tt = entries before the trigger, mm = trip mask (ZZZA encoding)
+//
+void MakeFlightRecorderStatusMessage(void)
+{
+  char Str[36];
+  byte Count, TriggerPos;
+  ERecorderState State;
+
+  State = GetFlightRecorderState(&Count, &TriggerPos);
+  strcpy(Str, "999");
+  AppendHex(Str, State, 2);
+  AppendHex(Str, Count, 2);
+  AppendHex(Str, TriggerPos, 2);
+  AppendHex(Str, GTripMask, 2);
+  MakeCATMessageString(eZZZR, Str);
+}
+
+
+//
+// handle a flight recorder request
+// ZZZRbbb; requests block bbb of a frozen capture: VRECORDERBLOCK entries, oldest first
+// reply is ZZZRbbb followed by 4 hex digits per entry (channel in top 3 bits, 13 bit reading)
+// ZZZR999; re-arms the recorder
+//
+void HandleFlightRecorderMessage(long Param)
+{
+  char Str[36];
+  byte Index, Cntr;
+
+  if (Param == 999)
+    FlightRecorderArm();
+  else if (Param < (VRECORDERSIZE / VRECORDERBLOCK))
+  {
+    Str[0] = '0' + (Param / 100);
+    Str[1] = '0' + ((Param / 10) % 10);
+    Str[2] = '0' + (Param % 10);
+    Str[3] = 0;
+    Index = Param * VRECORDERBLOCK;
+    for (Cntr = 0; Cntr < VRECORDERBLOCK; Cntr++)
+      AppendHex(Str, GetFlightRecorderEntry(Index + Cntr), 4);
+    MakeCATMessageString(eZZZR, Str);
+  }
+}
+
+
+//
+// handle an event log request
+// ZZZEaa; requests the logged record of age aa (00 = newest)
+// reply is ZZZEaa followed by the record as hex, 2 digits per byte in EEPROM order
+// (sequence, trip mask, 3 bytes on time, then temperature, voltage, current, fwd & rev power LS byte first)
+// the reply has no data if there is no valid record of that age
+//
+void HandleEventLogMessage(long Param)
+{
+  char Str[34];
+  SEventRecord Record;
+  byte* Ptr;
+  byte Cntr;
+
+  Str[0] = '0' + (Param / 10);
+  Str[1] = '0' + (Param % 10);
+  Str[2] = 0;
+  if (GetEventRecord(Param, &Record))
+  {
+    Ptr = (byte*)&Record;
+    for (Cntr = 0; Cntr < (VEVENTRECORDSIZE - 1); Cntr++)
+      AppendHex(Str, *Ptr++, 2);
+  }
+  MakeCATMessageString(eZZZE, Str);
+}
+
+
+//
+// send the SWR message
+// ZZZW; reply is ZZZWssssrrrr; ssss = SWR x100, rrrr = return loss x10 dB
+// both are 0 if the forward power is below the SWR gate threshold
+//
+void MakeSWRMessage(void)
+{
+  SSensorSnapshot Snapshot;
+
+  GetSensorSnapshot(&Snapshot);
+  MakeCATMessageNumeric(eZZZW, (Snapshot.SWR * 10000L) + Snapshot.ReturnLoss);
+}
+
+
+//
+// send the thermal forecast message (also sent unsolicited as the pre-trip warning)
+// ZZZH; reply is ZZZHttttssss; tttt = forecast seconds to trip (9999 = not heating),
+// ssss = heatsink temperature slope in 0.001C/s (0 if cooling)
+//
+void MakeThermalMessage(void)
+{
+  unsigned int TimeToTrip;
+  int Slope;
+
+  TimeToTrip = GetTimeToTrip();
+  if (TimeToTrip > 9999)
+    TimeToTrip = 9999;
+  Slope = constrain(GetTemperatureSlope(), 0, 9999);
+  MakeCATMessageNumeric(eZZZH, (TimeToTrip * 10000L) + Slope);
+}
+
+
+//
+// handle a task profile request message
+// ZZZPts; requests statistic s for scheduler task t (see ETask):
+// s: 0=min, 1=avg, 2=max (us, over the last second); 3=worst case since boot (us);
+// 4=overrun count; 5=late run count
+// reply is ZZZPtsvvvvv;
+// ZZZP90; requests the missed tick count (reply ZZZP90vvvvv;)
+// ZZZP99; clears the worst case times
+//
+void HandleTaskProfileMessage(long Param)
+{
+  byte Task, Stat;
+  unsigned int Value = 0;
+  bool ValidRequest = true;
+
+  Task = Param / 10;
+  Stat = Param % 10;
+  if (Param > 99)                                                     // selector is 2 digits
+    ValidRequest = false;
+  else if (Param == 99)
+  {
+    ClearTaskWorstCase();
+    ValidRequest = false;
+  }
+  else if (Param == 90)
+    Value = GetMissedTicks();
+  else if ((Task < VNUMTASKS) && (Stat <= eProfileWorst))
+    Value = GetTaskProfile((ETask)Task, (EProfileStat)Stat);
+  else if ((Task < VNUMTASKS) && (Stat == 4))
+    Value = GetTaskOverruns((ETask)Task);
+  else if ((Task < VNUMTASKS) && (Stat == 5))
+    Value = GetTaskLateRuns((ETask)Task);
+  else
+    ValidRequest = false;
+
+  if (ValidRequest)
+    MakeCATMessageNumeric(eZZZP, (Param * 100000L) + Value);
+}
+
+
+//
+// handle a config parameter message
+// ZZZCnn; reads parameter nn (see EConfigParam); reply is ZZZCnnvvvvv;
+// ZZZC1nnvvvvv; (8 digits, leading 1) sets parameter nn to vvvvv, then replies with the value
+// now set (a value outside the allowed range is not set). The change is saved to EEPROM.
+// any other form is ignored. Parameter values can't be negative over CAT.
+//
+#define VCONFIGWRITEFLAG 10000000L          // leading digit of a ZZZC write
+
+void HandleConfigMessage(long Param)
+{
+  byte Index = VNUMCONFIGPARAMS;
+
+  if (Param < 100)
+    Index = Param;
+  else if (Param >= VCONFIGWRITEFLAG)
+  {
+    Param -= VCONFIGWRITEFLAG;
+    Index = Param / 100000;
+    if (Index < VNUMCONFIGPARAMS)
+      SetConfigParam((EConfigParam)Index, Param % 100000);
+  }
+  if (Index < VNUMCONFIGPARAMS)
+    MakeCATMessageNumeric(eZZZC, (Index * 100000L) + GetConfigParam((EConfigParam)Index));
+}
+
+
 //
 // handle CAT commands with numerical parameters
 //
@@ -141,6 +436,27 @@ void HandleCATCommandNumParam(ECATCommands MatchedCAT, long ParsedParam)
     case eZZZS:
       HandleIncomingSWVersion(ParsedParam);
       break;
+    case eZZZM:                                                       // sensor statistics request
+      HandleStatisticsMessage(ParsedParam);
+      break;
+    case eZZZL:                                                       // trip latency request
+      HandleTripLatencyMessage(ParsedParam);
+      break;
+    case eZZZT:                                                       // trip cause time request
+      HandleTripTimeMessage(ParsedParam);
+      break;
+    case eZZZR:                                                       // flight recorder block request
+      HandleFlightRecorderMessage(ParsedParam);
+      break;
+    case eZZZE:                                                       // event log request
+      HandleEventLogMessage(ParsedParam);
+      break;
+    case eZZZC:                                                       // config parameter
+      HandleConfigMessage(ParsedParam);
+      break;
+    case eZZZP:                                                       // task profile request
+      HandleTaskProfileMessage(ParsedParam);
+      break;
   }
 }
 
@@ -156,7 +472,20 @@ void HandleCATCommandNoParam(ECATCommands MatchedCAT)
       MakeSoftwareVersionMessage();
       break;
     case eZZZA:                                                       // amplifier trip request
-      MakeAmplifierTripMessage(GTripCause, GResetActivated);    
+      MakeAmplifierTripMessage(GTripMask, GResetActivated);    
+      break;
+    case eZZZT:                                                       // trip cause request
+      MakeTripCauseMessage();
+      break;
+    case eZZZR:                                                       // flight recorder status request
+      MakeFlightRecorderStatusMessage();
+      break;
+    case eZZZW:                                                       // SWR request
+      MakeSWRMessage();
+      break;
+    case eZZZH:                                                       // thermal forecast request
+      MakeThermalMessage();
+      break;
   }
 }
 
@@ -26,14 +26,21 @@ extern long GFirmwareVersion;                  // radio firmware version
 #define VCURRENTTRIP 2
 #define VVOLTSGETRIP 4
 #define VTEMPTRIP 8
+#define VFWDPOWERTRIP 16
 //
 // function to send back a product ID message
-// Data holds the trip condition
+// TripMask holds the trip conditions (bits are OR-ed if more than one cause has tripped)
 // 0: no trip; 1: reverse power trip; 2: drain current trip; 4: PSU voltsge trip; 8: heatsink temperature trip
 // 16: high forward power trip
 // 64: can be reset
 //
-void MakeAmplifierTripMessage(ETripCause Data, bool CanReset);
+void MakeAmplifierTripMessage(byte TripMask, bool CanReset);
+
+
+//
+// send the thermal forecast message (also sent unsolicited as the pre-trip warning)
+//
+void MakeThermalMessage(void);
 
 
 
@@ -7,6 +7,15 @@
 //
 // configdata.h
 // this file holds the code to save and load settings to/from EEPROM
+//
+// there are two RAM copies of the config: the active copy GConfig, which is read
+// directly by the protection code, and an edit copy that CAT and the display change.
+// at the start of each tick any changes are copied to the active copy in one go,
+// so code running in a tick always sees a consistent set of settings.
+//
+// the EEPROM holds two copies of the config data, written alternately, each with a
+// sequence number and CRC. A record takes more than one page write, so power loss part way
+// through leaves that copy with a bad CRC, but the other copy still holds the last settings.
 /////////////////////////////////////////////////////////////////////////
 
 
@@ -14,75 +23,290 @@
 #include "globalinclude.h"
 
 #include <EEPROM.h>
+#include "configdata.h"
+#include "eepromwriter.h"
+#include "analogueio.h"
+#include "protect.h"
+
+#define VEEINITPATTERN 0x10                     // addr 0 set to this if configured by old layout
+#define VEECONFIGPATTERN 0x20                   // addr 0 set to this if configured by SConfigData
+#define VCONFIGVERSION 2                        // current SConfigData layout version
+#define VCONFIGADDR 0                           // EEPROM address of the first copy of config data
+#define VCONFIGSLOTSIZE 48                      // EEPROM reserved for each copy (event log follows both)
+#define VCONFIGNUMSLOTS 2
+#define VCONFIGV1NUMPARAMSOFFSET 2              // version 1 layout: one copy, no sequence number
+#define VCONFIGV1PINOFFSET 3
+#define VCONFIGV1PARAMOFFSET 5
 
-#define VEEINITPATTERN 0x10                     // addr 0 set to this if configured
+static_assert(sizeof(SConfigData) <= VCONFIGSLOTSIZE, "config data too big for its EEPROM slot");
 
-unsigned int GPin;                              // 4 diit stored PIN
+
+SConfigData GConfig;                            // active settings
+SConfigData GConfigEdit;                        // settings being edited
+bool GConfigChanged;                            // true if edit copy has changes
+SConfigData GConfigSave;                        // copy being written to EEPROM
+bool GConfigSaveNeeded;                         // true if the active copy hasn't been saved
+byte GConfigSlot;                               // EEPROM copy holding the newest settings
 
 
 //
-// function to copy all config settings to EEprom
-// this copies the current RAM vaiables to the persistent storage
-// addr 0: defined pattern (to know EEPROM has been initialised)
-// addr 1: normal encoder events per step
-// addr 2: VFO encoder events per steo
-// addr 3: display brightness
+// default value and allowed range for each parameter, in EConfigParam order
+// the comparator threshold PWM values are capped below full scale: 255 gives a 5V threshold,
+// which the sensors never reach, so would turn the hardware trip off. The cap of 200 (3.92V)
+// is 55A current, 61V PSU voltage or 480W reverse power.
 //
-void CopySettingsToEEprom(void)
+#define VMAXTHRESHOLDPWM 200
+
+struct SConfigParamLimits
 {
-  int Addr=1;
-  byte Setting;
-  int Cntr;
-  
-//
-// first set that we have initialised the EEprom
-//
-  EEPROM.write(0, VEEINITPATTERN);
+  int Default;
+  int Min;
+  int Max;
+};
+
+const SConfigParamLimits GConfigLimits[VNUMCONFIGPARAMS] = 
+{
+  {900, 300, 1000},                             // trip temp: 90C
+  {500, 200, 900},                              // temp reenable: 50C
+  {400, 0, 900},                                // fan on: 40C
+  {300, 0, 900},                                // fan off: 30C
+  {1500, 100, 2500},                            // fwd power limit: 1500W; excess above this is integrated
+  {40, 0, 500},                                 // fwd power reenable: 40W
+  {163, 1, VMAXTHRESHOLDPWM},                   // current PWM: 45A true current
+  {174, 1, VMAXTHRESHOLDPWM},                   // voltage PWM: 3.391V
+  {177, 1, VMAXTHRESHOLDPWM},                   // rev power PWM: 3.46V
+  {100, 10, 1000},                              // fwd excess time constant: 1s
+  {100, 10, 1000},                              // fwd excess trip: 100W mean excess
+  {5, 0, 1000},                                 // fwd excess re-enable: 5W mean excess
+  {50, 10, 1000},                               // SWR gate: 50W forward
+  {300, 110, 9999},                             // SWR trip: 3.00:1
+  {200, 101, 9999},                             // SWR re-enable: 2.00:1 (idle SWR reads 1.00, so must be above)
+  {120, 0, 3600}                                // thermal warning: 2 minutes before forecast trip
+};
+
+
+
 //
-// now copy settings from RAM data
+// set the edit copy to factory defaults
+// the settings here should match the fornt panel legend!
 //
-  EEPROM.put(1, GPin);
-}
+void SetConfigDefaults(void)
+{
+  byte Cntr;
 
+  GConfigEdit.Pin = 0;                          // initialise stored PIN to zero
+  for (Cntr = 0; Cntr < VNUMCONFIGPARAMS; Cntr++)
+    GConfigEdit.Param[Cntr] = GConfigLimits[Cntr].Default;
+}
 
 
 //
-// function to copy initial settings to EEprom
-// this sets the factory defaults
-// the settings here should match the fornt panel legend!
+// change a parameter. Returns false if the value is outside the allowed range, or would
+// cross a protection rule's trip and re-enable levels.
+// the change takes effect (and is saved to EEPROM) at the start of the next tick
 //
-void InitialiseEEprom(void)
+bool SetConfigParam(EConfigParam Param, int Value)
 {
-  int Cntr;
-  
-  GPin = 0;                           // initialise stored PIN to zero
+  bool Result = false;
 
-// now copy them to FLASH
-  CopySettingsToEEprom();
+  if ((Param < VNUMCONFIGPARAMS) && (Value >= GConfigLimits[Param].Min) && (Value <= GConfigLimits[Param].Max) &&
+      CheckProtectRuleLevels(Param, Value))
+  {
+    GConfigEdit.Param[Param] = Value;
+    GConfigChanged = true;
+    Result = true;
+  }
+  return Result;
 }
 
 
+//
+// read a parameter value including any change not yet made active
+//
+int GetConfigParam(EConfigParam Param)
+{
+  return GConfigEdit.Param[Param];
+}
+
 
 //
-// function to load config settings from flash
+// change the protection PIN
+// the change takes effect (and is saved to EEPROM) at the start of the next tick
 //
-void LoadSettingsFromEEprom(void)
+void SetConfigPin(unsigned int Pin)
 {
-  int Addr=1;
-  byte Setting;
-  int Cntr;
+  GConfigEdit.Pin = Pin;
+  GConfigChanged = true;
+}
+
 
 //
-// first see if we have initialised the EEprom previously
-// if not, copy settings to it
+// tick: called at the start of every 10ms tick, before any config is read
+// if there have been changes, make them active and save them
+// the active copy is saved to the EEPROM copy that doesn't hold the newest settings, and
+// only once the previous save has been written: until the new copy is complete, the
+// other copy is still good. The EEPROM writer reads GConfigSave, which only changes here.
 //
-  Setting = EEPROM.read(0);
-  if (Setting != VEEINITPATTERN)
-    InitialiseEEprom();
+void ConfigTick(void)
+{
+  byte Slot;
+
+  if (GConfigChanged)
+  {
+    GConfigChanged = false;
+    GConfig = GConfigEdit;
+    if (GProtectionEnforced)                    // re-drive thresholds in case they changed
+      SetPWMThresholds(false);
+    GConfigSaveNeeded = true;
+  }
+  if (GConfigSaveNeeded && !EEPROMWritePending(&GConfigSave, sizeof(SConfigData)))
+  {
+    Slot = GConfigSlot ^ 1;
+    GConfigSave = GConfig;
+    GConfigSave.Pattern = VEECONFIGPATTERN;
+    GConfigSave.Version = VCONFIGVERSION;
+    GConfigSave.Sequence = GConfig.Sequence + 1;
+    GConfigSave.NumParams = VNUMCONFIGPARAMS;
+    GConfigSave.CRC = CRC8((byte*)&GConfigSave, sizeof(SConfigData) - 1);
+    if (QueueEEPROMWrite(VCONFIGADDR + (Slot * VCONFIGSLOTSIZE), &GConfigSave, sizeof(SConfigData)))
+    {
+      GConfigSaveNeeded = false;
+      GConfigSlot = Slot;
+      GConfig.Sequence = GConfigSave.Sequence;
+      GConfigEdit.Sequence = GConfigSave.Sequence;
+    }
+  }
+}
+
+
 //
-// now copy out settings to RAM data
+// read one EEPROM copy of the config data into Config, which must hold the defaults
+// returns true if it has a layout version we know and its CRC is good; parameters added
+// since it was stored keep their defaults.
+// *LayoutKnown is set true if the version is known, even if the CRC is bad: the PIN is then
+// still read, because it is in the first page written.
+// version 1 (one copy, no sequence number) can only be in the first copy
 //
-  EEPROM.get(Addr, GPin);
+bool ReadConfigSlot(byte Slot, SConfigData* Config, bool* LayoutKnown)
+{
+  byte Stored[VCONFIGSLOTSIZE];
+  byte NumParams = 0;
+  byte PinOffset = 0;
+  byte ParamOffset = 0;
+  byte Length;
+  byte Cntr;
+  bool Result = false;
+
+  *LayoutKnown = false;
+  for (Cntr = 0; Cntr < VCONFIGSLOTSIZE; Cntr++)
+    Stored[Cntr] = EEPROM.read(VCONFIGADDR + (Slot * VCONFIGSLOTSIZE) + Cntr);
+  if (Stored[0] == VEECONFIGPATTERN)
+  {
+    if (Stored[offsetof(SConfigData, Version)] == VCONFIGVERSION)
+    {
+      NumParams = Stored[offsetof(SConfigData, NumParams)];
+      PinOffset = offsetof(SConfigData, Pin);
+      ParamOffset = offsetof(SConfigData, Param);
+      Config->Sequence = Stored[offsetof(SConfigData, Sequence)];
+      *LayoutKnown = true;
+    }
+    else if ((Stored[offsetof(SConfigData, Version)] == 1) && (Slot == 0))
+    {
+      NumParams = Stored[VCONFIGV1NUMPARAMSOFFSET];
+      PinOffset = VCONFIGV1PINOFFSET;
+      ParamOffset = VCONFIGV1PARAMOFFSET;
+      Config->Sequence = 0;
+      *LayoutKnown = true;
+    }
+  }
+  if (*LayoutKnown)
+  {
+    Length = ParamOffset + (NumParams * sizeof(int));
+    if (Length < VCONFIGSLOTSIZE)
+    {
+      memcpy(&Config->Pin, Stored + PinOffset, sizeof(Config->Pin));
+      if (CRC8(Stored, Length) == Stored[Length])
+      {
+        if (NumParams > VNUMCONFIGPARAMS)       // stored by newer code: use the parameters we know
+          NumParams = VNUMCONFIGPARAMS;
+        memcpy(Config->Param, Stored + ParamOffset, NumParams * sizeof(int));
+        Config->Version = Stored[offsetof(SConfigData, Version)];
+        Config->NumParams = NumParams;
+        Result = true;
+      }
+    }
+    else
+      *LayoutKnown = false;
+  }
+  return Result;
 }
 
 
+//
+// function to load config settings from EEprom
+// each EEPROM copy is read; the valid copy with the newer sequence number is used. addr 0 may hold:
+//   VEECONFIGPATTERN: SConfigData, version 2 (either copy) or version 1 (first copy only)
+//   VEEINITPATTERN:   old layout, PIN at addr 1. PIN kept, parameters take defaults
+//   anything else:    not initialised; factory defaults
+// if no copy is valid but one has a known layout, its PIN is kept with default parameters,
+// so a damaged copy doesn't silently turn protection off. A stored parameter outside its
+// allowed range (eg a threshold stored before the range was reduced) takes its default.
+// the loaded settings are then written back if they weren't stored in the current layout
+//
+void LoadSettingsFromEEprom(void)
+{
+  SConfigData Stored;
+  byte Slot;
+  unsigned int Pin = 0;
+  bool Found = false;
+  bool PinFound = false;
+  bool LayoutKnown;
+  bool OutOfRange = false;
+  byte Cntr;
+
+  SetConfigDefaults();
+  GConfigSlot = 1;                              // so that the first save is to the first copy
+  for (Slot = 0; Slot < VCONFIGNUMSLOTS; Slot++)
+  {
+    Stored = GConfigEdit;
+    if (ReadConfigSlot(Slot, &Stored, &LayoutKnown))
+    {
+      if (!Found || ((signed char)(Stored.Sequence - GConfig.Sequence) > 0))
+      {
+        GConfig = Stored;
+        GConfigSlot = Slot;
+        Found = true;
+      }
+    }
+    else if (LayoutKnown && !PinFound)
+    {
+      Pin = Stored.Pin;
+      PinFound = true;
+    }
+  }
+
+  if (Found)
+  {
+    GConfigEdit = GConfig;
+    for (Cntr = 0; Cntr < VNUMCONFIGPARAMS; Cntr++)
+      if ((GConfigEdit.Param[Cntr] < GConfigLimits[Cntr].Min) || (GConfigEdit.Param[Cntr] > GConfigLimits[Cntr].Max))
+      {
+        GConfigEdit.Param[Cntr] = GConfigLimits[Cntr].Default;
+        OutOfRange = true;
+      }
+  }
+  else if (PinFound)
+    GConfigEdit.Pin = Pin;
+  else if (EEPROM.read(VCONFIGADDR) == VEEINITPATTERN)
+  {
+    EEPROM.get(1, Pin);
+    GConfigEdit.Pin = Pin;
+  }
+//
+// make the settings active now, and save them unless they are already stored as they are
+//
+  GConfig = GConfigEdit;
+  GConfigChanged = false;
+  GConfigSaveNeeded = OutOfRange || !(Found && (GConfig.Version == VCONFIGVERSION) && (GConfig.NumParams == VNUMCONFIGPARAMS));
+  ConfigTick();
+}
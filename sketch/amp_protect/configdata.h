@@ -12,32 +12,93 @@
 #ifndef __CONFIGDATA_H
 #define __CONFIGDATA_H
 
+#include <Arduino.h>
+
+
+//
+// tunable parameters, held in the config data Param[] array
+// new parameters must be added at the end: stored configs are migrated by count
+//
+enum EConfigParam
+{
+  eParamTripTemp,                             // temperature to trip, 1DP C
+  eParamTempReenable,                         // temperature to allow reset, 1DP C
+  eParamFanOn,                                // fan on temperature, 1DP C
+  eParamFanOff,                               // fan off temperature, 1DP C
+  eParamTripFwdPower,                         // forward power limit for the excess integrator, watts
+  eParamFwdPowerReenable,                     // not used: kept so that stored indices stay the same
+  eParamCurrentPWM,                           // current comparator threshold PWM value
+  eParamVoltagePWM,                           // voltage comparator threshold PWM value
+  eParamRevPowerPWM,                          // reverse power comparator threshold PWM value
+  eParamFwdExcessTau,                         // forward power excess integrator time constant, ticks
+  eParamFwdExcessTrip,                        // forward power mean excess to trip, watts
+  eParamFwdExcessReenable,                    // forward power mean excess to re-enable, watts
+  eParamSWRGate,                              // minimum forward power for an SWR reading, watts
+  eParamTripSWR,                              // SWR to trip, 2DP
+  eParamSWRReenable,                          // SWR to re-enable, 2DP
+  eParamThermalWarnTime                       // forecast time to trip for the pre-trip warning, s (0 = off)
+};
+#define VNUMCONFIGPARAMS 16
+
+
+//
+// config data, as stored in EEPROM
+// two copies are kept (see configdata.cpp); the one with the newer sequence number is used
+//
+struct SConfigData
+{
+  byte Pattern;                               // VEECONFIGPATTERN if this layout
+  byte Version;                               // layout version
+  byte Sequence;                              // increments for every copy written
+  byte NumParams;                             // number of entries in Param[] when stored
+  unsigned int Pin;                           // 4 digit protection PIN; 0 if not protected
+  int Param[VNUMCONFIGPARAMS];                // tunable parameters
+  byte CRC;                                   // CRC8 of all bytes above
+};
 
 
 //
 // RAM storage of loaded settings
-// these are loaded from FLASH after boot up
+// these are loaded from EEPROM after boot up. This is the "active" copy, which
+// only changes between ticks; read it directly eg GConfig.Param[eParamTripTemp]
 //
-extern unsigned int GPin;                                  // 4 diit stored PIN
+extern SConfigData GConfig;
+
 
 //
-// function to copy all config settings to EEprom
+// change a parameter. Returns false if the value is outside the allowed range, or would
+// cross a protection rule's trip and re-enable levels.
+// the change takes effect (and is saved to EEPROM) at the start of the next tick
 //
-void CopySettingsToEEprom(void);
+bool SetConfigParam(EConfigParam Param, int Value);
 
 
 //
-// function to load config settings from EEprom
-// initialises EEPROM if it hadn't already been initialised. 
+// read a parameter value including any change not yet made active
 //
-void LoadSettingsFromEEprom(void);
+int GetConfigParam(EConfigParam Param);
 
 
 //
-// function to check EEprom is initialised, and load it if not
-// called on start-up BEFORE loading the settings
+// change the protection PIN
+// the change takes effect (and is saved to EEPROM) at the start of the next tick
 //
-void CheckEEpromInitialised(void);
+void SetConfigPin(unsigned int Pin);
+
+
+//
+// tick: called at the start of every 10ms tick, before any config is read
+// if there have been changes, make them active and queue an EEPROM write
+//
+void ConfigTick(void);
+
+
+//
+// function to load config settings from EEprom
+// initialises EEPROM if it hadn't already been initialised. 
+// migrates settings from earlier layouts
+//
+void LoadSettingsFromEEprom(void);
 
 
 #endif  //not defined
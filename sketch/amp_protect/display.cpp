@@ -18,6 +18,10 @@
 #include "protect.h"
 #include "configdata.h"
 #include "cathandler.h"
+#include "sensorstats.h"
+#include "eventlog.h"
+#include "taskprofile.h"
+#include "displayqueue.h"
 
 
 
@@ -52,31 +56,13 @@ NexPage page4 = NexPage(4, 0, "page4");       // creates touch event for "about"
 NexPage page5 = NexPage(5, 0, "page5");       // creates touch event for "engineering" page
 
 //
-// page 1 objects:
-// 
-NexText p1OnTime = NexText(1, 5, "p1t5");                   // on time
-NexText p1HsTemp = NexText(1, 8, "p1t8");                   // heatsink temp
-NexText p1Voltage = NexText(1, 10, "p1t10");                // PSU voltage
-NexText p1Protect = NexText(1, 20, "p1t20");                // protection state
-
+// objects that are only written are in the display queue object table (displayqueue.cpp)
+// the objects declared here are the ones that send touch events or are read
 //
-// page 2 objects:
-// 
-NexText p2HsTemp = NexText(2, 11, "p2t16");                 // heatsink temp
-NexText p2Voltage = NexText(2, 12, "p2t17");                // PSU voltage
-NexText p2Current = NexText(2, 13, "p2t18");                // drain current
-NexProgressBar p2FwdProgress = NexProgressBar(2, 20, "p2j0");            // forward power bar
-NexProgressBar p2RevProgress = NexProgressBar(2, 21, "p2j1");            // forward power bar
-NexText p2Protect = NexText(2, 22, "p2t20");                // protection state
 
 //
 // page 3 objects:
 // 
-NexText p3HsTemp = NexText(3, 13, "p3t13");                 // heatsink temp
-NexText p3Voltage = NexText(3, 14, "p3t14");                // PSU voltage
-NexText p3Current = NexText(3, 15, "p3t15");                // drain current
-NexText p3FwdPower = NexText(3, 16, "p3t16");               // forward power
-NexText p3RevPower = NexText(3, 17, "p3t17");               // reverse power
 NexText p3HsTempLabel = NexText(3, 1, "p3t1");              // heatsink temp label
 NexText p3VoltageLabel = NexText(3, 4, "p3t4");             // PSU voltage label
 NexText p3CurrentLabel = NexText(3, 5, "p3t5");             // drain current label
@@ -87,9 +73,6 @@ NexButton p3Reset = NexButton(3, 2, "p3b2");                // RESET pushbutton
 //
 // page 4 objects:
 // 
-NexText p4SWVersion = NexText(4, 4, "p4t4");                // s/w version
-NexText p4FWVersion = NexText(4, 6, "p4t6");                // FPGA f/w version
-NexText p4p2appVersion = NexText(4, 8, "p4t8");             // p2app s/w version
 NexButton p3Engineering = NexButton(4, 1, "p4b0");          // Engineering pushbutton
 
 //
@@ -193,6 +176,7 @@ unsigned char mysprintf(char *dest, int Value, bool AddDP)
 void page0PushCallback(void *ptr)             // called when page 0 loads (splash page)
 {
   GDisplayPage = eSplashPage;
+  DisplayQueuePageShown(0);                            // display resets the page objects when it loads
 }
 
 
@@ -202,8 +186,9 @@ void page0PushCallback(void *ptr)             // called when page 0 loads (splas
 void page1PushCallback(void *ptr)             // called when page 1 loads (RX page)
 {
   GDisplayPage = eRXPage;
+  DisplayQueuePageShown(1);                            // display resets the page objects when it loads
   if(GProtectionEnforced)
-    p1Protect.setText("Protected");
+    DisplayQueueText(eObjP1Protect, "Protected");
 
 }
 
@@ -213,42 +198,44 @@ void page1PushCallback(void *ptr)             // called when page 1 loads (RX pa
 void page2PushCallback(void *ptr)             // called when page 2 loads (TX page)
 {
   GDisplayPage = eTXPage;
+  DisplayQueuePageShown(2);                            // display resets the page objects when it loads
   if(GProtectionEnforced)
-    p2Protect.setText("Protected");
+    DisplayQueueText(eObjP2Protect, "Protected");
 }
 
+//
+// page 3 trip cause objects, in ETripCause order (no object for eNoTrip)
+//
+const char* GTripCauseObjects[] = {"", "p3t5", "p3t4", "p3t1", "p3t6", "p3t7"};
+
+
 //
 // page 3 - Tripped page callback
-// set page, then change object background colour
+// set page, then change object background colour of every latched cause:
+// red for the first cause, yellow for any that followed
 //
 void page3PushCallback(void *ptr)             // called when page 3 loads (tripped page)
 {
+  byte Cause;
+  char Str[20];
+
   GDisplayPage = eTrippedPage;
+  DisplayQueuePageShown(3);                            // display resets the page objects when it loads
 
-  if(GTripCause == eTripCurrent)
+  for (Cause = eTripCurrent; Cause <= eTripRevPower; Cause++)
   {
-    sendCommand("p3t5.bco=RED");
-    sendCommand("ref p3t5");
-  }
-  else if(GTripCause == eTripPSUVoltage)
-  {
-    sendCommand("p3t4.bco=RED");
-    sendCommand("ref p3t4");
-  }
-  else if(GTripCause == eTripTemperature)
-  {
-    sendCommand("p3t1.bco=RED");
-    sendCommand("ref p3t1");
-  }
-  else if(GTripCause == eTripFwdPower)
-  {
-    sendCommand("p3t6.bco=RED");
-    sendCommand("ref p3t6");
-  }
-  else if(GTripCause == eTripRevPower)
-  {
-    sendCommand("p3t7.bco=RED");
-    sendCommand("ref p3t7");
+    if (GTripMask & TripCauseBit((ETripCause)Cause))
+    {
+      strcpy(Str, GTripCauseObjects[Cause]);
+      if (Cause == GTripCause)
+        strcat(Str, ".bco=RED");                  // first cause
+      else
+        strcat(Str, ".bco=YELLOW");               // subsequent causes
+      sendCommand(Str);
+      strcpy(Str, "ref ");
+      strcat(Str, GTripCauseObjects[Cause]);
+      sendCommand(Str);
+    }
   }
 }
 
@@ -259,25 +246,94 @@ void page4PushCallback(void *ptr)             // called when page 4 loads (about
 {
   char Str[10];
   GDisplayPage = eAboutPage;
+  DisplayQueuePageShown(4);                            // display resets the page objects when it loads
   mysprintf(Str, SWVERSION, false);
-  p4SWVersion.setText(Str);
+  DisplayQueueText(eObjP4SWVersion, Str);
 
   if(Gp2appVersion != 0)
   {
     mysprintf(Str, Gp2appVersion, false);
-    p4p2appVersion.setText(Str);
+    DisplayQueueText(eObjP4p2appVersion, Str);
   }
 
   if(GFirmwareVersion != 0)
   {
     mysprintf(Str, GFirmwareVersion, false);
-    p4FWVersion.setText(Str);
+    DisplayQueueText(eObjP4FWVersion, Str);
   }
 
 }
 
 
 
+//
+// names for each trip cause bit in the event log, in ZZZA bit order
+//
+const char* GTripBitNames[] = {"Rev ", "Cur ", "PSU ", "Temp ", "Fwd "};
+
+
+//
+// show the newest event log record on the engineering page
+// shown as the trip causes then the on time (h:mm:ss) when it tripped
+//
+void DisplayLastTrip(void)
+{
+  char Str[40];
+  SEventRecord Record;
+  unsigned long OnTime;
+  byte Bit;
+  byte Pos;
+
+  if (GetEventRecord(0, &Record))
+  {
+    Str[0] = 0;
+    for (Bit = 0; Bit < 5; Bit++)
+      if (Record.TripMask & (1 << Bit))
+        strcat(Str, GTripBitNames[Bit]);
+    OnTime = GetEventOnTime(&Record);
+    Pos = strlen(Str);
+    ltoa(OnTime / 3600, Str + Pos, 10);           // hours
+    Pos = strlen(Str);
+    OnTime = OnTime % 3600;
+    Str[Pos++] = ':';
+    Str[Pos++] = (OnTime / 600) + VASCII0;        // tens of minutes
+    Str[Pos++] = ((OnTime / 60) % 10) + VASCII0;  // units of minutes
+    Str[Pos++] = ':';
+    Str[Pos++] = ((OnTime % 60) / 10) + VASCII0;  // tens of seconds
+    Str[Pos++] = (OnTime % 10) + VASCII0;         // units of seconds
+    Str[Pos] = 0;
+  }
+  else
+    strcpy(Str, "none");
+  DisplayQueueText(eObjP5LastTrip, Str);
+}
+
+
+//
+// names for each scheduler task, in ETask order
+//
+const char* GTaskNames[VNUMTASKS] = {"Cfg ", "ADC ", "Prot ", "Therm ", "LED ", "CAT ", "EEP ", "Disp "};
+
+
+//
+// show the execution profile of one task on the engineering page
+// shown as the task name then avg/max over the last second and worst since boot, in us
+//
+void DisplayTaskProfile(byte Task)
+{
+  char Str[40];
+
+  strcpy(Str, GTaskNames[Task]);
+  utoa(GetTaskProfile((ETask)Task, eProfileAvg), Str + strlen(Str), 10);
+  strcat(Str, "/");
+  utoa(GetTaskProfile((ETask)Task, eProfileMax), Str + strlen(Str), 10);
+  strcat(Str, "/");
+  utoa(GetTaskProfile((ETask)Task, eProfileWorst), Str + strlen(Str), 10);
+  strcat(Str, "us");
+  DisplayQueueText(eObjP5Profile, Str);
+}
+
+
 //
 // page 5 - engineering page callback
 //
@@ -285,8 +341,11 @@ void page5PushCallback(void *ptr)             // called when page 5 loads (engin
 {
   char Str[10];
   GDisplayPage = eEngineeringPage;
+  DisplayQueuePageShown(5);                            // display resets the page objects when it loads
+  GDisplayData = 0;                             // start the task profiles from the first task
   if(GProtectionEnforced)
-    p5Protect.setText("Active");
+    DisplayQueueText(eObjP5Protect, "Active");
+  DisplayLastTrip();
 }
 
 
@@ -311,28 +370,26 @@ void p5ProtectPushCallback(void *ptr)              // reset trips pushbutton
   Result = p5PIN.getValue(&EnteredPIN);
   if(EnteredPIN != 0)                               // no action if entered PIN is zero
   {
-    if(GPin == 0)                                   // if no protection PIN is stored
+    if(GConfig.Pin == 0)                            // if no protection PIN is stored
     {
-      GPin = EnteredPIN;                            // store new PIN to EEPROM
-      CopySettingsToEEprom();
+      SetConfigPin(EnteredPIN);                     // store new PIN to EEPROM
       EnforceProtection(true);                      // enable protection
-      p5Protect.setText("Active");
+      DisplayQueueText(eObjP5Protect, "Active");
     }
     else
     {
-      if (GPin == EnteredPIN)                       // if equal, toggle protection state
+      if (GConfig.Pin == EnteredPIN)                // if equal, toggle protection state
       {
         if(GProtectionEnforced)
         {
-          GPin = 0;                                 // set PIN back to zero if unprotected
-          CopySettingsToEEprom();
+          SetConfigPin(0);                          // set PIN back to zero if unprotected
           EnforceProtection(false);
-          p5Protect.setText("Inactive");
+          DisplayQueueText(eObjP5Protect, "Inactive");
         }
         else
         {
           EnforceProtection(true);
-          p5Protect.setText("Active");
+          DisplayQueueText(eObjP5Protect, "Active");
         }
       }
     }
@@ -360,6 +417,7 @@ void DisplayInit(void)
 // set baud rate & register event callback functions
 //  
   nexInit(115200);
+  DisplayQueueInit();
   page0.attachPush(page0PushCallback);
   page1.attachPush(page1PushCallback);
   page2.attachPush(page2PushCallback);
@@ -381,6 +439,7 @@ void DisplayTick(void)
   float CurrentPower;
   int PercentForwardPower;
   int PercentReversePower;
+  unsigned int SWR;
 //
 // handle touch display events
 //  
@@ -402,12 +461,12 @@ void DisplayTick(void)
         {
           case 0:                                         // display temp
             mysprintf(Str, GetTemperature()/10, false);   // temp in C
-            p1HsTemp.setText(Str);
+            DisplayQueueText(eObjP1HsTemp, Str);
             break;
 
           case 1:                                         // display PSU voltage
             mysprintf(Str, GetPSUVoltage()/10, false);    // voltage in whole volts
-            p1Voltage.setText(Str);
+            DisplayQueueText(eObjP1Voltage, Str);
             break;
         }
         GDisplayThrottleTicks = VTENTHSECOND;
@@ -429,17 +488,17 @@ void DisplayTick(void)
       {
         switch(GDisplayData)
         {
-          case 0:                                         // display forward power
-            CurrentPower = (float)GetForwardPeakPower(true);
+          case 0:                                         // display forward power (peak over last second)
+            CurrentPower = (float)GetStatistic(eStatsFwdPower, eStatsWindow1s, eStatsMax);
             PercentForwardPower = (int) (CurrentPower * 100.0/1800.0);
             PercentForwardPower = min(PercentForwardPower, 100);
-            p2FwdProgress.setValue(PercentForwardPower);
+            DisplayQueueValue(eObjP2FwdProgress, PercentForwardPower);
             break;
-          case 1:                                         // display reverse power
-            CurrentPower = (float)GetReversePeakPower(true);
+          case 1:                                         // display reverse power (peak over last second)
+            CurrentPower = (float)GetStatistic(eStatsRevPower, eStatsWindow1s, eStatsMax);
             PercentReversePower = (int) (CurrentPower * 100.0/450.0);
             PercentReversePower = min(PercentReversePower, 100);
-            p2RevProgress.setValue(PercentReversePower);
+            DisplayQueueValue(eObjP2RevProgress, PercentReversePower);
             break;
           case 2:                                         // display something else
 
@@ -447,18 +506,26 @@ void DisplayTick(void)
             {
               case 0:                                         // display temperature
                 mysprintf(Str, GetTemperature()/10, false);   // temp in C
-                p2HsTemp.setText(Str);
+                DisplayQueueText(eObjP2HsTemp, Str);
                 break;
               case 1:                                         // display PSU voltage   
                 mysprintf(Str, GetPSUVoltage()/10, false);    // voltage in whole volts
-                p2Voltage.setText(Str);
+                DisplayQueueText(eObjP2Voltage, Str);
                 break;
               case 2:                                         // display current
                 mysprintf(Str, GetCurrent(), true);           // current in fractional A
-                p2Current.setText(Str);
+                DisplayQueueText(eObjP2Current, Str);
+                break;
+              case 3:                                         // display SWR
+                SWR = GetSWR();
+                if (SWR == 0)                                 // forward power too low to measure
+                  strcpy(Str, "--");
+                else
+                  mysprintf(Str, SWR/10, true);               // SWR to 1 decimal place
+                DisplayQueueText(eObjP2SWR, Str);
                 break;
             }
-            if (GSecondaryDisplayData == 2)                   // and set up to display next object
+            if (GSecondaryDisplayData == 3)                   // and set up to display next object
               GSecondaryDisplayData=0;
             else
               GSecondaryDisplayData++;
@@ -483,23 +550,23 @@ void DisplayTick(void)
           case 0:              
           // display temperature
             mysprintf(Str, GetTemperature()/10, false);   // temp in C
-            p3HsTemp.setText(Str);
+            DisplayQueueText(eObjP3HsTemp, Str);
             break;
           case 1:                                         // display PSU voltage   
             mysprintf(Str, GetPSUVoltage()/10, false);    // voltage in whole volts
-            p3Voltage.setText(Str);
+            DisplayQueueText(eObjP3Voltage, Str);
             break;
           case 2:                                         // display current
             mysprintf(Str, GetCurrent(), true);           // current in fractional A
-            p3Current.setText(Str);
+            DisplayQueueText(eObjP3Current, Str);
             break;
           case 3:                                         // display forward power
             mysprintf(Str, GetForwardPower(), false);     // forward power in W
-            p3FwdPower.setText(Str);
+            DisplayQueueText(eObjP3FwdPower, Str);
             break;
           case 4:                                         // display reverse power
             mysprintf(Str, GetReversePower(), false);     // reverse power in W
-            p3RevPower.setText(Str);
+            DisplayQueueText(eObjP3RevPower, Str);
             break;
         }
         GDisplayThrottleTicks = VTENTHSECOND;
@@ -517,9 +584,33 @@ void DisplayTick(void)
 
       break;
 
+
+    case eEngineeringPage:                          // engineering page: step through the task profiles
+      if(GDisplayThrottleTicks == 0)                      // update display if timed out
+      {
+        DisplayTaskProfile(GDisplayData);
+        if (GDisplayData == 0)                            // missed ticks once per cycle of tasks
+        {
+          strcpy(Str, "Missed ");
+          utoa(GetMissedTicks(), Str + strlen(Str), 10);
+          DisplayQueueText(eObjP5Missed, Str);
+        }
+        GDisplayThrottleTicks = VHALFSECOND;
+        if (GDisplayData >= (VNUMTASKS - 1))              // and set up to display next task
+          GDisplayData=0;
+        else
+          GDisplayData++;
+      }
+      else
+        GDisplayThrottleTicks--;
+      break;
+
       
   }
-
+//
+// send whatever display changes fit in this tick
+//
+  DisplayQueueTick();
 }
 
 
@@ -530,7 +621,7 @@ void DisplayTick(void)
 void DisplaySetOnTime(char* Str)
 {
   if(GDisplayPage == eRXPage)
-    p1OnTime.setText(Str);
+    DisplayQueueText(eObjP1OnTime, Str);
 }
 
 
@@ -542,28 +633,7 @@ void SetDisplayPage(EDisplayPage NewPage)
   GDisplayPage = NewPage;
   GDisplayThrottleTicks = VHALFSECOND;
   GDisplayData = 0;
-  switch (NewPage)
-  {
-    case  eSplashPage:
-      page0.show();
-      break;
-
-    case eRXPage:                                  // "normal" RX page display
-      page1.show();
-      break;
-
-    case eTXPage:                                  // "normal" TX page display
-      page2.show();
-      break;
-      
-    case eTrippedPage:                             // page when h/w tripped
-      page3.show();
-      break;
-
-    case eAboutPage:                                // about page
-      page4.show();
-      break;
-  }
+  DisplayQueuePage((byte)NewPage);               // page numbers are in EDisplayPage order
 }
 
 //
@@ -572,9 +642,9 @@ void SetDisplayPage(EDisplayPage NewPage)
 void ActivateResetButton(bool AllowReset)
 {
   if(AllowReset)
-    p3Reset.setText("RESET");
+    DisplayQueueText(eObjP3Reset, "RESET");
   else
-    p3Reset.setText("-----");
+    DisplayQueueText(eObjP3Reset, "-----");
 }
 
 
@@ -0,0 +1,264 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// displayqueue.cpp
+// this file holds the Nextion display command queue
+//
+// each display object has one buffer holding its latest value, and a flag saying whether
+// that value has been sent. A new value replaces any unsent one (so repeated writes coalesce)
+// and a value the same as the one already sent isn't sent again. Once per tick the unsent
+// values for the page on display are sent, round robin, up to a byte budget; the budget is
+// never more than the space in the serial transmit buffer, so the tick never waits on the UART.
+// commands are written to the serial port directly rather than by sendCommand(), which
+// discards any received bytes (and with them, touch events) and waits for a reply.
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include <Nextion.h>
+#include "displayqueue.h"
+
+
+#define VDISPLAYBYTEBUDGET 64               // bytes per tick (115200 baud sends ~115 bytes per tick)
+#define VNOPAGE 0xFF
+
+
+struct SDisplayObject
+{
+  byte Page;                                // page the object is on
+  const char* Name;                         // object name
+  bool Numeric;                             // true for .val, false for .txt
+  byte Size;                                // value buffer size, including terminator
+};
+
+
+//
+// the object table, in EDisplayObject order
+//
+constexpr SDisplayObject GDisplayObjects[VNUMDISPLAYOBJECTS] =
+{
+  {1, "p1t5", false, 12},                   // on time, hhh:mm:ss
+  {1, "p1t8", false, 8},
+  {1, "p1t10", false, 8},
+  {1, "p1t20", false, 10},
+  {2, "p2t16", false, 8},
+  {2, "p2t17", false, 8},
+  {2, "p2t18", false, 8},
+  {2, "p2j0", true, 4},                     // 0-100%
+  {2, "p2j1", true, 4},
+  {2, "p2t20", false, 10},
+  {2, "p2t23", false, 8},
+  {3, "p3t13", false, 8},
+  {3, "p3t14", false, 8},
+  {3, "p3t15", false, 8},
+  {3, "p3t16", false, 8},
+  {3, "p3t17", false, 8},
+  {3, "p3b2", false, 6},
+  {4, "p4t4", false, 8},
+  {4, "p4t6", false, 8},
+  {4, "p4t8", false, 8},
+  {5, "p5bt0", false, 10},
+  {5, "p5t8", false, 32},                   // trip causes and on time
+  {5, "p5t9", false, 32},                   // task name and times
+  {5, "p5t10", false, 16}
+};
+
+
+//
+// total of the buffer sizes of the first Count objects, found at compile time
+// (so it is also the pool offset of object Count)
+//
+constexpr unsigned int DisplayPoolSize(int Count)
+{
+  return (Count == 0) ? 0 : GDisplayObjects[Count - 1].Size + DisplayPoolSize(Count - 1);
+}
+
+
+char GDisplayPool[DisplayPoolSize(VNUMDISPLAYOBJECTS)];   // value buffers for all objects
+unsigned int GDisplayOffset[VNUMDISPLAYOBJECTS];          // pool offset of each object's buffer
+bool GDisplayWritten[VNUMDISPLAYOBJECTS];                 // true if a value has been set
+bool GDisplaySent[VNUMDISPLAYOBJECTS];                    // true if the value is on the display
+byte GDisplayNextObject;                                  // round robin start for the next tick
+byte GDisplayShownPage;                                   // page on display
+byte GDisplayPendingPage;                                 // page change to send, or VNOPAGE
+
+
+
+//
+// initialise - clear all object values, nothing to send
+//
+void DisplayQueueInit(void)
+{
+  byte Cntr;
+
+  for (Cntr = 0; Cntr < VNUMDISPLAYOBJECTS; Cntr++)
+  {
+    GDisplayOffset[Cntr] = DisplayPoolSize(Cntr);
+    GDisplayWritten[Cntr] = false;
+    GDisplaySent[Cntr] = false;
+  }
+  memset(GDisplayPool, 0, sizeof(GDisplayPool));
+  GDisplayNextObject = 0;
+  GDisplayShownPage = 0;                                // nexInit() shows page 0
+  GDisplayPendingPage = VNOPAGE;
+}
+
+
+//
+// set the text of a text object (or button)
+// nothing is sent if it is the same as the text already on the display.
+// if the object already has an unsent value, it is replaced: only the latest is sent.
+// text too long for the object's buffer is truncated.
+//
+void DisplayQueueText(EDisplayObject Object, const char* Text)
+{
+  char* Buffer;
+  byte Length;
+
+  Buffer = GDisplayPool + GDisplayOffset[Object];
+  Length = GDisplayObjects[Object].Size - 1;
+  if (!GDisplayWritten[Object] || (strncmp(Buffer, Text, Length) != 0))
+  {
+    strncpy(Buffer, Text, Length);
+    Buffer[Length] = 0;
+    GDisplayWritten[Object] = true;
+    GDisplaySent[Object] = false;
+  }
+}
+
+
+//
+// set the value of a numeric object (eg progress bar), with the same rules as text
+//
+void DisplayQueueValue(EDisplayObject Object, unsigned int Value)
+{
+  char Str[8];
+
+  utoa(Value, Str, 10);
+  DisplayQueueText(Object, Str);
+}
+
+
+//
+// request a page change. The page command is sent before any object values.
+//
+void DisplayQueuePage(byte Page)
+{
+  GDisplayPendingPage = Page;
+}
+
+
+//
+// note that the display has loaded a page (from its touch event)
+// the display resets a page's objects when it loads, so all known values for the page are re-sent
+//
+void DisplayQueuePageShown(byte Page)
+{
+  byte Cntr;
+
+  GDisplayShownPage = Page;
+  for (Cntr = 0; Cntr < VNUMDISPLAYOBJECTS; Cntr++)
+    if (GDisplayObjects[Cntr].Page == Page)
+      GDisplaySent[Cntr] = false;
+}
+
+
+//
+// find the number of bytes needed to send an object's value
+// name, ".txt=" and quotes (or ".val="), value, then 3 terminating 0xFF bytes
+//
+byte DisplayCommandLength(byte Object)
+{
+  byte Length;
+
+  Length = strlen(GDisplayObjects[Object].Name) + strlen(GDisplayPool + GDisplayOffset[Object]) + 3;
+  if (GDisplayObjects[Object].Numeric)
+    Length += 5;
+  else
+    Length += 7;
+  return Length;
+}
+
+
+//
+// write one object's value command to the display
+//
+void SendDisplayObject(byte Object)
+{
+  nexSerial.print(GDisplayObjects[Object].Name);
+  if (GDisplayObjects[Object].Numeric)
+    nexSerial.print(".val=");
+  else
+    nexSerial.print(".txt=\"");
+  nexSerial.print(GDisplayPool + GDisplayOffset[Object]);
+  if (!GDisplayObjects[Object].Numeric)
+    nexSerial.print("\"");
+  nexSerial.write(0xFF);
+  nexSerial.write(0xFF);
+  nexSerial.write(0xFF);
+  GDisplaySent[Object] = true;
+}
+
+
+//
+// 10ms tick: send queued commands for the page on display, up to the per tick byte budget
+// and never more than will fit in the serial transmit buffer, so it never waits.
+// a command that doesn't fit is first in line next tick.
+//
+void DisplayQueueTick(void)
+{
+  int Budget;
+  byte Cntr;
+  byte Object;
+  byte Length;
+  bool Full = false;
+
+  Budget = nexSerial.availableForWrite();
+  if (Budget > VDISPLAYBYTEBUDGET)
+    Budget = VDISPLAYBYTEBUDGET;
+//
+// page change first: "page n" then terminator
+//
+  if (GDisplayPendingPage != VNOPAGE)
+  {
+    if (Budget >= 9)
+    {
+      nexSerial.print("page ");
+      nexSerial.print((long)GDisplayPendingPage);
+      nexSerial.write(0xFF);
+      nexSerial.write(0xFF);
+      nexSerial.write(0xFF);
+      Budget -= 9;
+      DisplayQueuePageShown(GDisplayPendingPage);
+      GDisplayPendingPage = VNOPAGE;
+    }
+    else
+      Full = true;
+  }
+//
+// then the unsent values for objects on the page shown
+//
+  Object = GDisplayNextObject;
+  for (Cntr = 0; (Cntr < VNUMDISPLAYOBJECTS) && !Full; Cntr++)
+  {
+    if (GDisplayWritten[Object] && !GDisplaySent[Object] && (GDisplayObjects[Object].Page == GDisplayShownPage))
+    {
+      Length = DisplayCommandLength(Object);
+      if (Length <= Budget)
+      {
+        SendDisplayObject(Object);
+        Budget -= Length;
+      }
+      else
+      {
+        GDisplayNextObject = Object;
+        Full = true;
+      }
+    }
+    if (++Object >= VNUMDISPLAYOBJECTS)
+      Object = 0;
+  }
+}
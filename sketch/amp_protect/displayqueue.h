@@ -0,0 +1,93 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// displayqueue.h
+// this file holds the Nextion display command queue: the latest value for each display
+// object, sent in the background only when it has changed
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __DISPLAYQUEUE_H
+#define __DISPLAYQUEUE_H
+
+#include <Arduino.h>
+
+
+//
+// the display objects written through the queue, in the order of the object table
+//
+enum EDisplayObject
+{
+  eObjP1OnTime,                             // page 1: on time
+  eObjP1HsTemp,                             // heatsink temp
+  eObjP1Voltage,                            // PSU voltage
+  eObjP1Protect,                            // protection state
+  eObjP2HsTemp,                             // page 2: heatsink temp
+  eObjP2Voltage,                            // PSU voltage
+  eObjP2Current,                            // drain current
+  eObjP2FwdProgress,                        // forward power bar
+  eObjP2RevProgress,                        // reverse power bar
+  eObjP2Protect,                            // protection state
+  eObjP2SWR,                                // SWR
+  eObjP3HsTemp,                             // page 3: heatsink temp
+  eObjP3Voltage,                            // PSU voltage
+  eObjP3Current,                            // drain current
+  eObjP3FwdPower,                           // forward power
+  eObjP3RevPower,                           // reverse power
+  eObjP3Reset,                              // RESET pushbutton text
+  eObjP4SWVersion,                          // page 4: s/w version
+  eObjP4FWVersion,                          // FPGA f/w version
+  eObjP4p2appVersion,                       // p2app s/w version
+  eObjP5Protect,                            // page 5: protection pushbutton text
+  eObjP5LastTrip,                           // most recent logged trip
+  eObjP5Profile,                            // task execution profile
+  eObjP5Missed                              // scheduler missed ticks
+};
+#define VNUMDISPLAYOBJECTS 24
+
+
+//
+// initialise - clear all object values, nothing to send
+//
+void DisplayQueueInit(void);
+
+
+//
+// set the text of a text object (or button)
+// nothing is sent if it is the same as the text already on the display.
+// if the object already has an unsent value, it is replaced: only the latest is sent.
+// text too long for the object's buffer is truncated.
+//
+void DisplayQueueText(EDisplayObject Object, const char* Text);
+
+
+//
+// set the value of a numeric object (eg progress bar), with the same rules as text
+//
+void DisplayQueueValue(EDisplayObject Object, unsigned int Value);
+
+
+//
+// request a page change. The page command is sent before any object values.
+//
+void DisplayQueuePage(byte Page);
+
+
+//
+// note that the display has loaded a page (from its touch event)
+// the display resets a page's objects when it loads, so all known values for the page are re-sent
+//
+void DisplayQueuePageShown(byte Page);
+
+
+//
+// 10ms tick: send queued commands for the page on display, up to the per tick byte budget
+// and never more than will fit in the serial transmit buffer, so it never waits.
+//
+void DisplayQueueTick(void);
+
+
+#endif      // file sentry
@@ -0,0 +1,167 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// eepromwriter.cpp
+// this file holds the background EEPROM writer: a queue of ranges to copy from
+// RAM to EEPROM, programmed at most one EEPROM page per 10ms tick
+//
+// the 4809 EEPROM is memory mapped. Writing a mapped address loads the NVM page buffer;
+// a page erase/write command then programs only the bytes that were loaded. So for each
+// tick the bytes of one page that differ from RAM are loaded ("update" semantics: unchanged
+// bytes are never rewritten) and one command programs them all. The command runs in the
+// background: the next tick does nothing until the EEPROM is no longer busy.
+// all EEPROM writes must go through here, so the page buffer is always empty on entry.
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include "eepromwriter.h"
+
+
+//
+// one queued range
+//
+struct SEEPROMRange
+{
+  unsigned int Addr;                        // EEPROM address of next byte to write
+  const byte* Source;                       // RAM address of next byte to write
+  byte Length;                              // bytes still to write
+};
+
+SEEPROMRange GEEQueue[VEEQUEUESIZE];
+byte GEEQueueHead;                          // oldest queued range
+byte GEEQueueCount;                         // number of queued ranges
+
+
+
+//
+// queue a range of RAM to be copied to EEPROM
+// the RAM is read when each page is programmed, so it must stay valid until written;
+// if it changes in the meantime the latest value is written.
+// a range that is already queued isn't queued again.
+// returns false if the queue is full
+//
+bool QueueEEPROMWrite(unsigned int Addr, const void* Source, byte Length)
+{
+  bool Result = true;
+  bool Found = false;
+  byte Cntr;
+  SEEPROMRange* Range;
+
+  for (Cntr = 0; Cntr < GEEQueueCount; Cntr++)
+  {
+    Range = GEEQueue + ((GEEQueueHead + Cntr) % VEEQUEUESIZE);
+    if ((Range->Addr == Addr) && (Range->Source == (const byte*)Source) && (Range->Length == Length))
+      Found = true;
+  }
+  if (!Found)
+  {
+    if (GEEQueueCount >= VEEQUEUESIZE)
+      Result = false;
+    else
+    {
+      Range = GEEQueue + ((GEEQueueHead + GEEQueueCount) % VEEQUEUESIZE);
+      Range->Addr = Addr;
+      Range->Source = (const byte*)Source;
+      Range->Length = Length;
+      GEEQueueCount++;
+    }
+  }
+  return Result;
+}
+
+
+//
+// return true if any part of a RAM range is still waiting to be written
+//
+bool EEPROMWritePending(const void* Source, byte Length)
+{
+  bool Result = false;
+  byte Cntr;
+  SEEPROMRange* Range;
+  const byte* Start;
+
+  Start = (const byte*)Source;
+  for (Cntr = 0; Cntr < GEEQueueCount; Cntr++)
+  {
+    Range = GEEQueue + ((GEEQueueHead + Cntr) % VEEQUEUESIZE);
+    if ((Range->Source < (Start + Length)) && (Start < (Range->Source + Range->Length)))
+      Result = true;
+  }
+  return Result;
+}
+
+
+//
+// CRC8 (Dallas/Maxim polynomial) of a block of bytes
+//
+byte CRC8(const byte* Data, byte Length)
+{
+  byte CRC = 0;
+  byte Bit;
+  byte Value;
+
+  while (Length--)
+  {
+    Value = *Data++;
+    for (Bit = 0; Bit < 8; Bit++)
+    {
+      if ((CRC ^ Value) & 1)
+        CRC = (CRC >> 1) ^ 0x8C;
+      else
+        CRC >>= 1;
+      Value >>= 1;
+    }
+  }
+  return CRC;
+}
+
+
+//
+// 10ms tick: if the EEPROM isn't busy, program the changed bytes of one page
+// a range that crosses a page boundary takes more than one tick
+//
+void EEPROMWriterTick(void)
+{
+  SEEPROMRange* Range;
+  volatile byte* Mapped;
+  byte PageBytes;
+  byte Changed = 0;
+  byte Cntr;
+
+  if ((GEEQueueCount != 0) && ((NVMCTRL.STATUS & NVMCTRL_EEBUSY_bm) == 0))
+  {
+    Range = GEEQueue + GEEQueueHead;
+    PageBytes = EEPROM_PAGE_SIZE - (Range->Addr & (EEPROM_PAGE_SIZE - 1));
+    if (PageBytes > Range->Length)
+      PageBytes = Range->Length;
+//
+// load the page buffer with the bytes that differ, then program them
+//
+    Mapped = (volatile byte*)(MAPPED_EEPROM_START + Range->Addr);
+    for (Cntr = 0; Cntr < PageBytes; Cntr++)
+    {
+      if (Mapped[Cntr] != Range->Source[Cntr])
+      {
+        Mapped[Cntr] = Range->Source[Cntr];
+        Changed++;
+      }
+    }
+    if (Changed != 0)
+      _PROTECTED_WRITE_SPM(NVMCTRL.CTRLA, NVMCTRL_CMD_PAGEERASEWRITE_gc);
+//
+// step on; remove the range when complete
+//
+    Range->Addr += PageBytes;
+    Range->Source += PageBytes;
+    Range->Length -= PageBytes;
+    if (Range->Length == 0)
+    {
+      GEEQueueHead = (GEEQueueHead + 1) % VEEQUEUESIZE;
+      GEEQueueCount--;
+    }
+  }
+}
@@ -0,0 +1,50 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// eepromwriter.h
+// this file holds the background EEPROM writer: a queue of ranges to copy from
+// RAM to EEPROM, programmed at most one EEPROM page per 10ms tick
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __EEPROMWRITER_H
+#define __EEPROMWRITER_H
+
+#include <Arduino.h>
+
+
+#define VEEQUEUESIZE 4                      // number of ranges that can be queued
+
+
+//
+// queue a range of RAM to be copied to EEPROM
+// the RAM is read when each page is programmed, so it must stay valid until written;
+// if it changes in the meantime the latest value is written.
+// a range that is already queued isn't queued again.
+// returns false if the queue is full
+//
+bool QueueEEPROMWrite(unsigned int Addr, const void* Source, byte Length);
+
+
+//
+// return true if any part of a RAM range is still waiting to be written
+//
+bool EEPROMWritePending(const void* Source, byte Length);
+
+
+//
+// CRC8 (Dallas/Maxim polynomial) of a block of bytes, used to check stored records
+//
+byte CRC8(const byte* Data, byte Length);
+
+
+//
+// 10ms tick: if the EEPROM isn't busy, program the changed bytes of one page
+//
+void EEPROMWriterTick(void);
+
+
+#endif      // file sentry
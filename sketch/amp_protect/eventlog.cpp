@@ -0,0 +1,155 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// eventlog.cpp
+// this file holds the persistent trip event log in EEPROM
+//
+// records are written to the slots in turn, so the wear is spread evenly over all of the
+// log area. Each record carries a sequence number and a CRC: at power up the newest valid
+// record is found from the sequence numbers (modulo 256, so it works through wrap).
+// writing is "write behind": a record is built in RAM then queued to the EEPROM writer,
+// so the tick never waits for an EEPROM write. Records are page aligned, so each is
+// programmed by one page write; a record interrupted by power loss will fail its CRC.
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "eventlog.h"
+#include "analogueio.h"
+#include "ontime.h"
+#include "eepromwriter.h"
+
+
+byte GEventNewestSlot;                      // slot of newest valid record
+byte GEventNewestSequence;                  // its sequence number
+bool GEventLogEmpty;                        // true if no valid records
+
+SEventRecord GEventPending;                 // record being written
+
+
+
+//
+// read one slot from EEPROM; returns true if its CRC is valid
+//
+bool ReadEventSlot(byte Slot, SEventRecord* Record)
+{
+  byte* Ptr;
+  byte Cntr;
+  int Addr;
+
+  Ptr = (byte*)Record;
+  Addr = VEVENTLOGBASE + (Slot * VEVENTRECORDSIZE);
+  for (Cntr = 0; Cntr < VEVENTRECORDSIZE; Cntr++)
+    *Ptr++ = EEPROM.read(Addr++);
+  return (CRC8((byte*)Record, VEVENTRECORDSIZE - 1) == Record->CRC);
+}
+
+
+//
+// initialise: scan the EEPROM log to find the newest valid record
+// the newest is the one whose sequence is furthest ahead of the others,
+// using signed 8 bit differences so the sequence can wrap
+//
+void EventLogInit(void)
+{
+  byte Slot;
+  SEventRecord Record;
+
+  GEventLogEmpty = true;
+  for (Slot = 0; Slot < VEVENTLOGSLOTS; Slot++)
+  {
+    if (ReadEventSlot(Slot, &Record))
+    {
+      if (GEventLogEmpty || ((signed char)(Record.Sequence - GEventNewestSequence) > 0))
+      {
+        GEventNewestSlot = Slot;
+        GEventNewestSequence = Record.Sequence;
+        GEventLogEmpty = false;
+      }
+    }
+  }
+}
+
+
+//
+// log a trip event: the record is built now, from the latest sensor snapshot,
+// and written to EEPROM in the background by the EEPROM writer
+// if a previous record is still being written, this one is dropped
+// the new record becomes the newest straight away; reading it back fails its
+// sequence/CRC check until it has been programmed
+//
+void LogTripEvent(byte TripMask)
+{
+  SSensorSnapshot Snapshot;
+  unsigned long OnTime;
+  byte Slot;
+
+  if (!EEPROMWritePending(&GEventPending, VEVENTRECORDSIZE))
+  {
+    GetSensorSnapshot(&Snapshot);
+    OnTime = GetOnTimeSeconds();
+    if (GEventLogEmpty)
+    {
+      Slot = 0;
+      GEventPending.Sequence = 0;
+    }
+    else
+    {
+      Slot = GEventNewestSlot + 1;
+      if (Slot >= VEVENTLOGSLOTS)
+        Slot = 0;
+      GEventPending.Sequence = GEventNewestSequence + 1;
+    }
+    GEventPending.TripMask = TripMask;
+    GEventPending.OnTime[0] = OnTime & 0xFF;
+    GEventPending.OnTime[1] = (OnTime >> 8) & 0xFF;
+    GEventPending.OnTime[2] = (OnTime >> 16) & 0xFF;
+    GEventPending.Temperature = Snapshot.Temperature;
+    GEventPending.PSUVolts = Snapshot.PSUVolts;
+    GEventPending.Current = Snapshot.Current;
+    GEventPending.FwdPower = Snapshot.FwdPower;
+    GEventPending.RevPower = Snapshot.RevPower;
+    GEventPending.CRC = CRC8((byte*)&GEventPending, VEVENTRECORDSIZE - 1);
+    if (QueueEEPROMWrite(VEVENTLOGBASE + (Slot * VEVENTRECORDSIZE), &GEventPending, VEVENTRECORDSIZE))
+    {
+      GEventNewestSlot = Slot;
+      GEventNewestSequence = GEventPending.Sequence;
+      GEventLogEmpty = false;
+    }
+  }
+}
+
+
+//
+// read a record from the log. Age 0 is the newest.
+// returns false if there is no valid record of that age
+// (a record is only valid if its CRC matches and it is in sequence with the newest)
+//
+bool GetEventRecord(byte Age, SEventRecord* Record)
+{
+  bool Result = false;
+  int Slot;
+
+  if ((!GEventLogEmpty) && (Age < VEVENTLOGSLOTS))
+  {
+    Slot = (int)GEventNewestSlot - Age;
+    if (Slot < 0)
+      Slot += VEVENTLOGSLOTS;
+    if (ReadEventSlot(Slot, Record))
+      Result = (Record->Sequence == (byte)(GEventNewestSequence - Age));
+  }
+  return Result;
+}
+
+
+//
+// get the seconds since power on stored in a record
+//
+unsigned long GetEventOnTime(SEventRecord* Record)
+{
+  return (unsigned long)Record->OnTime[0] | ((unsigned long)Record->OnTime[1] << 8) | ((unsigned long)Record->OnTime[2] << 16);
+}
@@ -0,0 +1,72 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// eventlog.h
+// this file holds the persistent trip event log in EEPROM
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __EVENTLOG_H
+#define __EVENTLOG_H
+
+#include <Arduino.h>
+
+
+//
+// EEPROM layout: addresses 0-95 are reserved for two copies of the config data (see configdata.cpp)
+// the rest of the 256 byte EEPROM holds a circular log of 16 byte records
+//
+#define VEVENTLOGBASE 96                    // first EEPROM address of the log
+#define VEVENTRECORDSIZE 16                 // bytes per record
+#define VEVENTLOGSLOTS 10                   // (256-96)/16
+
+
+//
+// one log record, exactly as stored in EEPROM
+// sensor values are as returned by the analogueio getters
+//
+struct SEventRecord
+{
+  byte Sequence;                            // increments for every record written
+  byte TripMask;                            // trip causes (ZZZA bit encoding)
+  byte OnTime[3];                           // seconds since power on, LS byte first
+  int Temperature;                          // 1DP
+  unsigned int PSUVolts;                    // 1DP
+  unsigned int Current;                     // 1DP
+  unsigned int FwdPower;                    // watts
+  unsigned int RevPower;                    // watts
+  byte CRC;                                 // CRC8 of all bytes above
+};
+
+
+//
+// initialise: scan the EEPROM log to find the newest valid record
+//
+void EventLogInit(void);
+
+
+//
+// log a trip event: the record is built now, from the latest sensor snapshot,
+// and written to EEPROM in the background by the EEPROM writer
+// if a previous record is still being written, this one is dropped
+//
+void LogTripEvent(byte TripMask);
+
+
+//
+// read a record from the log. Age 0 is the newest.
+// returns false if there is no valid record of that age
+//
+bool GetEventRecord(byte Age, SEventRecord* Record);
+
+
+//
+// get the seconds since power on stored in a record
+//
+unsigned long GetEventOnTime(SEventRecord* Record);
+
+
+#endif      // file sentry
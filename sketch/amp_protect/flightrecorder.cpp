@@ -0,0 +1,122 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// flightrecorder.cpp
+// this file holds the trip "flight recorder": a ring of the most recent raw ADC
+// samples that freezes shortly after a trip, keeping the pre-trigger history
+//
+// every ADC result (after decimation to 13 bits, before filtering) is written to the
+// ring by the ADC interrupt. When a trip latches the recorder counts VRECORDERPOST more
+// samples, then stops writing. The capture stays frozen until re-armed (by a trip reset
+// or over CAT) so it can be downloaded while the amplifier is tripped.
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include "flightrecorder.h"
+
+
+volatile unsigned int GRecorderRing[VRECORDERSIZE];
+volatile byte GRecorderHead;                // next entry to write
+volatile byte GRecorderCount;               // valid entries (saturates at VRECORDERSIZE)
+volatile byte GRecorderPostCount;           // samples still to record after the trigger
+volatile byte GRecorderTriggerPos;          // valid entries at the trigger
+volatile ERecorderState GRecorderState;
+
+
+
+//
+// arm the recorder: clear the capture and start recording
+//
+void FlightRecorderArm(void)
+{
+  noInterrupts();
+  GRecorderHead = 0;
+  GRecorderCount = 0;
+  GRecorderTriggerPos = 0;
+  GRecorderState = eRecorderArmed;
+  interrupts();
+}
+
+
+//
+// add one ADC sample (called from the ADC interrupt)
+//
+void FlightRecorderSample(byte Channel, unsigned int Reading)
+{
+  byte Head;
+
+  if (GRecorderState != eRecorderFrozen)
+  {
+    Head = GRecorderHead;
+    GRecorderRing[Head] = ((unsigned int)Channel << VRECORDERCHANSHIFT) | Reading;
+    GRecorderHead = (Head + 1) & VRECORDERMASK;
+    if (GRecorderCount < VRECORDERSIZE)
+      GRecorderCount++;
+    else if (GRecorderTriggerPos != 0)
+      GRecorderTriggerPos--;                      // oldest pre-trigger sample overwritten
+
+    if (GRecorderState == eRecorderTriggered)
+      if (--GRecorderPostCount == 0)
+        GRecorderState = eRecorderFrozen;
+  }
+}
+
+
+//
+// trigger: record VRECORDERPOST more samples then freeze
+// called when a trip first latches. Ignored unless armed.
+//
+void FlightRecorderTrigger(void)
+{
+  byte OldSREG;
+
+  OldSREG = SREG;
+  noInterrupts();
+  if (GRecorderState == eRecorderArmed)
+  {
+    GRecorderTriggerPos = GRecorderCount;
+    GRecorderPostCount = VRECORDERPOST;
+    GRecorderState = eRecorderTriggered;
+  }
+  SREG = OldSREG;
+}
+
+
+//
+// read the recorder state
+// Count = number of valid entries; TriggerPos = number of entries before the trigger
+//
+ERecorderState GetFlightRecorderState(byte* Count, byte* TriggerPos)
+{
+  ERecorderState State;
+
+  noInterrupts();
+  State = GRecorderState;
+  *Count = GRecorderCount;
+  *TriggerPos = GRecorderTriggerPos;
+  interrupts();
+  return State;
+}
+
+
+//
+// read one entry of a frozen capture, oldest first
+// returns 0 if the capture is not frozen
+// once frozen the ring isn't written, so no interrupt protection is needed
+//
+unsigned int GetFlightRecorderEntry(byte Index)
+{
+  unsigned int Entry = 0;
+  byte Oldest;
+
+  if ((GRecorderState == eRecorderFrozen) && (Index < GRecorderCount))
+  {
+    Oldest = (GRecorderHead - GRecorderCount) & VRECORDERMASK;
+    Entry = GRecorderRing[(Oldest + Index) & VRECORDERMASK];
+  }
+  return Entry;
+}
@@ -0,0 +1,71 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// flightrecorder.h
+// this file holds the trip "flight recorder": a ring of the most recent raw ADC
+// samples that freezes shortly after a trip, keeping the pre-trigger history
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __FLIGHTRECORDER_H
+#define __FLIGHTRECORDER_H
+
+#include <Arduino.h>
+
+
+//
+// capture size. Each entry is one ADC sample: channel in the top 3 bits, 13 bit reading below
+// at the fast (current and RF power) scan rate 128 entries is roughly 11ms
+//
+#define VRECORDERSIZE 128                   // must be a power of 2
+#define VRECORDERMASK (VRECORDERSIZE-1)
+#define VRECORDERPOST 32                    // samples recorded after the trigger
+#define VRECORDERCHANSHIFT 13               // channel position in an entry
+#define VRECORDERBLOCK 8                    // entries per CAT download block
+
+
+enum ERecorderState
+{
+  eRecorderArmed,                           // recording, waiting for a trip
+  eRecorderTriggered,                       // recording the post trigger samples
+  eRecorderFrozen                           // capture complete
+};
+
+
+//
+// arm the recorder: clear the capture and start recording
+//
+void FlightRecorderArm(void);
+
+
+//
+// add one ADC sample (called from the ADC interrupt)
+//
+void FlightRecorderSample(byte Channel, unsigned int Reading);
+
+
+//
+// trigger: record VRECORDERPOST more samples then freeze
+// called when a trip first latches. Ignored unless armed.
+//
+void FlightRecorderTrigger(void);
+
+
+//
+// read the recorder state
+// Count = number of valid entries; TriggerPos = number of entries before the trigger
+//
+ERecorderState GetFlightRecorderState(byte* Count, byte* TriggerPos);
+
+
+//
+// read one entry of a frozen capture, oldest first
+// returns 0 if the capture is not frozen
+//
+unsigned int GetFlightRecorderEntry(byte Index);
+
+
+#endif      // file sentry
@@ -0,0 +1,29 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// fwdexcess.cpp
+// this file holds the forward power excess detector (a leaky integrator)
+// it has no Arduino dependencies, so it can also be built on a host (see test/)
+/////////////////////////////////////////////////////////////////////////
+
+#include "fwdexcess.h"
+
+
+//
+// one tick of the forward power excess detector
+// the integral is at most Tau x the largest excess (1000 x 2500), so it fits in a long
+//
+int FwdExcessStep(long* Integral, int Power, int Limit, int Tau)
+{
+  int Excess;
+
+  Excess = Power - Limit;
+  if (Excess < 0)
+    Excess = 0;
+  *Integral += Excess - (*Integral / Tau);
+  return *Integral / Tau;
+}
@@ -0,0 +1,30 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// fwdexcess.h
+// this file holds the forward power excess detector (a leaky integrator)
+// it has no Arduino dependencies, so it can also be built on a host (see test/)
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __FWDEXCESS_H
+#define __FWDEXCESS_H
+
+
+//
+// one tick of the forward power excess detector
+// a leaky integrator of the forward power above the limit, with time constant Tau ticks:
+//   I = I - I/Tau + max(0, Power - Limit)
+// Integral holds I (watt-ticks) between calls; start it at 0.
+// returns I/Tau, the (exponentially weighted) mean excess power in watts.
+// Short peaks above the limit contribute little. The result is in whole watts, so a trip
+// rule (result above T) needs a mean excess of T+1: a sustained excess E trips within
+// Tau x ln(E/(E-T-1)) ticks, eg 0.7 x Tau if E is twice T.
+//
+int FwdExcessStep(long* Integral, int Power, int Limit, int Tau);
+
+
+#endif      // file sentry
@@ -0,0 +1,108 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// hwtrip.cpp
+// optional hardware trip path: the 4809 event system and CCL gate the amplifier
+// enable with the comparator inputs, with no CPU involvement
+//
+// the CCL LUT inputs can't read port E pins directly, so the comparators are routed
+// as events. Only event channels 4 and 5 can take port E pins, so the two fast trips
+// (current comparator PE0 and reverse power SR flip flop PE3) are gated in hardware.
+// The PSU voltage comparator stays on the interrupt path only.
+//
+// LUT0 inputs:  IN0 = event A (current comparator, high if tripped)
+//               IN1 = PA1 pin (VPINAMPENABLE, the firmware enable)
+//               IN2 = event B (SR flip flop, low if tripped)
+// LUT0 output PA3 = firmware enable AND NOT current trip AND SR OK.
+// PA3 is driven by the LUT (OUTEN), so it isn't set up with pinMode. The board ties PA3 to the
+// A5 header pin, which is also PF3: PF3 must be left as an input, or it fights the LUT output.
+// the gate is combinatorial: the trip is latched by the interrupt handler clearing PA1
+// (and by the SR flip flop for reverse power).
+// the register values and truth tables are found in hwtripconfig.cpp, which is host tested.
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include "hwtrip.h"
+#include "hwtripconfig.h"
+#include "iopins.h"
+
+
+//
+// the register values in hwtripconfig.h are from the datasheet, so check them against the device header
+//
+static_assert(VEVGENPORT0PIN0 == EVSYS_GENERATOR_PORT0_PIN0_gc, "EVSYS generator value");
+static_assert(VEVGENPORT0PIN3 == EVSYS_GENERATOR_PORT0_PIN3_gc, "EVSYS generator value");
+static_assert(VEVUSERCHANNEL4 == EVSYS_CHANNEL_CHANNEL4_gc, "EVSYS user value");
+static_assert(VEVUSERCHANNEL5 == EVSYS_CHANNEL_CHANNEL5_gc, "EVSYS user value");
+static_assert(VCCLENABLE == CCL_ENABLE_bm, "CCL enable bit");
+static_assert(VCCLOUTEN == CCL_OUTEN_bm, "CCL output enable bit");
+static_assert(VCCLINSEL0EVENTA == CCL_INSEL0_EVENTA_gc, "CCL input select value");
+static_assert(VCCLINSEL1IO == CCL_INSEL1_IO_gc, "CCL input select value");
+static_assert(VCCLINSEL2EVENTB == CCL_INSEL2_EVENTB_gc, "CCL input select value");
+static_assert(VPORTMUXLUT0ALT == PORTMUX_LUT0_bm, "PORTMUX LUT0 bit");
+
+bool GHardwareTripReady;                    // true when the CCL has been set up
+bool GHardwareTripEnforced;                 // true if the gate is enforced
+
+
+
+//
+// initialise: route the comparators through the event system into CCL LUT0
+// must be called with the amplifier enable output low
+//
+void HardwareTripInit(void)
+{
+  SHwTripRegs Regs;
+
+  HwTripRegisterValues(GHardwareTripEnforced, &Regs);
+  HwTripWriteRegisters(&Regs, EVSYS, CCL, PORTMUX);
+  GHardwareTripReady = true;
+}
+
+
+//
+// set whether the hardware gate is enforced
+// if not enforced the LUT simply copies VPINAMPENABLE to VPINHWAMPENABLE
+// can be called before HardwareTripInit(): the setting is applied when the CCL is set up
+//
+void HardwareTripEnforce(bool IsEnforced)
+{
+  GHardwareTripEnforced = IsEnforced;
+  if (GHardwareTripReady)
+    HwTripWriteTruth(HwTripTruth(IsEnforced), CCL);
+}
+
+
+//
+// return true if the hardware gate is holding the amplifier off
+// while the firmware enable is asserted
+//
+bool HardwareTripGateActive(void)
+{
+  byte PortA;
+
+  PortA = VPORTA.IN;
+  return ((PortA & VPORTAMPENABLEBIT) != 0) && ((PortA & PIN3_bm) == 0);
+}
+
+
+//
+// read back the trip cause from the hardware gate inputs
+// returns eNoTrip if neither gated input is active
+//
+ETripCause ReadHardwareTripCause(void)
+{
+  ETripCause Cause = eNoTrip;
+  byte PortE;
+
+  PortE = VPORTE.IN;
+  if (PortE & VPORTCURRENTCOMPBIT)
+    Cause = eTripCurrent;
+  if ((PortE & VPORTREVPOWERSRBIT) == 0)
+    Cause = eTripRevPower;
+  return Cause;
+}
@@ -0,0 +1,57 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// hwtrip.h
+// optional hardware trip path: the 4809 event system and CCL gate the amplifier
+// enable with the comparator inputs, with no CPU involvement
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __HWTRIP_H
+#define __HWTRIP_H
+
+#include <Arduino.h>
+#include "protect.h"
+
+
+//
+// define this to use the hardware trip path. It needs a board modification:
+// the amplifier enable is taken from VPINHWAMPENABLE (the CCL LUT0 output) instead of VPINAMPENABLE.
+// the interrupt handler still deasserts the outputs and records the cause.
+//
+//#define VHARDWARETRIP
+
+
+//
+// initialise: route the comparators through the event system into CCL LUT0
+// must be called with the amplifier enable output low
+//
+void HardwareTripInit(void);
+
+
+//
+// set whether the hardware gate is enforced
+// if not enforced the LUT simply copies VPINAMPENABLE to VPINHWAMPENABLE
+// can be called before HardwareTripInit(): the setting is applied when the CCL is set up
+//
+void HardwareTripEnforce(bool IsEnforced);
+
+
+//
+// return true if the hardware gate is holding the amplifier off
+// while the firmware enable is asserted
+//
+bool HardwareTripGateActive(void);
+
+
+//
+// read back the trip cause from the hardware gate inputs
+// returns eNoTrip if neither gated input is active
+//
+ETripCause ReadHardwareTripCause(void);
+
+
+#endif      // file sentry
@@ -0,0 +1,52 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// hwtripconfig.cpp
+// this file holds the register settings for the hardware trip path (see hwtrip.cpp)
+// it has no Arduino dependencies, so it can also be built on a host (see test/)
+/////////////////////////////////////////////////////////////////////////
+
+#include "hwtripconfig.h"
+
+
+//
+// find the LUT0 truth table, by evaluating the gate for each of the 8 input combinations
+// (gated: 0x40, only index 6; follow: 0xCC, indexes 2, 3, 6, 7)
+//
+unsigned char HwTripTruth(bool IsEnforced)
+{
+  unsigned char Truth = 0;
+  unsigned char Index;
+  bool Output;
+
+  for (Index = 0; Index < 8; Index++)
+  {
+    Output = ((Index & VLUTIN1) != 0);
+    if (IsEnforced)
+      Output = Output && ((Index & VLUTIN0) == 0) && ((Index & VLUTIN2) != 0);
+    if (Output)
+      Truth |= (1 << Index);
+  }
+  return Truth;
+}
+
+
+//
+// find all the register values for the hardware trip path
+// only event channels 4 and 5 can take port E pins (as their port 0)
+//
+void HwTripRegisterValues(bool IsEnforced, SHwTripRegs* Regs)
+{
+  Regs->EvsysChannel4 = VEVGENPORT0PIN0;            // PE0 current comparator
+  Regs->EvsysChannel5 = VEVGENPORT0PIN3;            // PE3 reverse power SR flip flop
+  Regs->EvsysUserLut0A = VEVUSERCHANNEL4;
+  Regs->EvsysUserLut0B = VEVUSERCHANNEL5;
+  Regs->Lut0CtrlA = VCCLOUTEN | VCCLENABLE;         // no filter: no added delay
+  Regs->Lut0CtrlB = VCCLINSEL0EVENTA | VCCLINSEL1IO;
+  Regs->Lut0CtrlC = VCCLINSEL2EVENTB;
+  Regs->Truth0 = HwTripTruth(IsEnforced);
+}
@@ -0,0 +1,110 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// hwtripconfig.h
+// this file holds the register settings for the hardware trip path (see hwtrip.cpp):
+// the event system routing and CCL LUT0 set up, and the LUT truth tables.
+// it has no Arduino dependencies, so it can also be built on a host (see test/): the
+// register values are given here from the ATmega4809 datasheet, and hwtrip.cpp checks
+// them against the device header at compile time.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __HWTRIPCONFIG_H
+#define __HWTRIPCONFIG_H
+
+
+//
+// register values (ATmega4809 datasheet)
+//
+#define VEVGENPORT0PIN0 0x40                // EVSYS.CHANNELn generator: port 0 pin 0 (channel 4: PE0)
+#define VEVGENPORT0PIN3 0x43                // port 0 pin 3 (channel 4 or 5: PE3)
+#define VEVUSERCHANNEL4 0x05                // EVSYS.USERx: connect to channel 4
+#define VEVUSERCHANNEL5 0x06                // connect to channel 5
+#define VCCLENABLE 0x01                     // CCL.CTRLA and LUTnCTRLA ENABLE
+#define VCCLOUTEN 0x08                      // LUTnCTRLA OUTEN: drive the LUT output pin
+#define VCCLINSEL0EVENTA 0x03               // LUTnCTRLB INSEL0 (bits 3:0): event A
+#define VCCLINSEL1IO 0x50                   // LUTnCTRLB INSEL1 (bits 7:4): IO pin (LUT0 IN1 = PA1)
+#define VCCLINSEL2EVENTB 0x04               // LUTnCTRLC INSEL2 (bits 3:0): event B
+#define VPORTMUXLUT0ALT 0x01                // PORTMUX.CCLROUTEA: LUT0 output on PA6 instead of PA3
+
+
+//
+// LUT truth table index bits: the truth table bit for inputs (IN2, IN1, IN0) is bit IN2:IN1:IN0
+//
+#define VLUTIN0 0x01                        // event A: current comparator, high if tripped
+#define VLUTIN1 0x02                        // PA1: firmware amplifier enable
+#define VLUTIN2 0x04                        // event B: SR flip flop, low if tripped
+
+
+//
+// the register values to write
+//
+struct SHwTripRegs
+{
+  unsigned char EvsysChannel4;              // generator for channel 4
+  unsigned char EvsysChannel5;              // generator for channel 5
+  unsigned char EvsysUserLut0A;             // channel for LUT0 event A
+  unsigned char EvsysUserLut0B;             // channel for LUT0 event B
+  unsigned char Lut0CtrlA;                  // written last, to enable the LUT
+  unsigned char Lut0CtrlB;
+  unsigned char Lut0CtrlC;
+  unsigned char Truth0;
+};
+
+
+//
+// find the LUT0 truth table
+// not enforced: the output follows the firmware enable (IN1)
+// enforced: the output is the firmware enable AND NOT current trip (IN0) AND SR OK (IN2)
+//
+unsigned char HwTripTruth(bool IsEnforced);
+
+
+//
+// find all the register values for the hardware trip path
+//
+void HwTripRegisterValues(bool IsEnforced, SHwTripRegs* Regs);
+
+
+//
+// write the register values to the event system and CCL, in an order the CCL accepts:
+// the LUT registers are only writable with the CCL disabled.
+// the register blocks are parameters so that the host test can pass a register model
+// (on the device they are EVSYS, CCL and PORTMUX)
+//
+template <class TEvsys, class TCcl, class TPortmux>
+void HwTripWriteRegisters(const SHwTripRegs* Regs, TEvsys& Evsys, TCcl& Ccl, TPortmux& Portmux)
+{
+  Evsys.CHANNEL4 = Regs->EvsysChannel4;
+  Evsys.CHANNEL5 = Regs->EvsysChannel5;
+  Evsys.USERCCLLUT0A = Regs->EvsysUserLut0A;
+  Evsys.USERCCLLUT0B = Regs->EvsysUserLut0B;
+  Portmux.CCLROUTEA &= ~VPORTMUXLUT0ALT;            // LUT0 output on PA3
+
+  Ccl.CTRLA = 0;
+  Ccl.LUT0CTRLA = 0;
+  Ccl.LUT0CTRLB = Regs->Lut0CtrlB;
+  Ccl.LUT0CTRLC = Regs->Lut0CtrlC;
+  Ccl.TRUTH0 = Regs->Truth0;
+  Ccl.LUT0CTRLA = Regs->Lut0CtrlA;
+  Ccl.CTRLA = VCCLENABLE;
+}
+
+
+//
+// change the LUT0 truth table (the CCL is disabled while it is written)
+//
+template <class TCcl>
+void HwTripWriteTruth(unsigned char Truth, TCcl& Ccl)
+{
+  Ccl.CTRLA = 0;
+  Ccl.TRUTH0 = Truth;
+  Ccl.CTRLA = VCCLENABLE;
+}
+
+
+#endif      // file sentry
@@ -29,8 +29,23 @@
 #define VPINSRRESET  4            // reset output to flip flop
 #define VPINAMPENABLE 7           // enable output for PTT and bias
 #define VPINPSUENABLE 2           // power supply enable
-#define VPINFAN 6                 // fan output (may not be needed)
+#define VPINFAN 6                 // fan output: 31.4KHz PWM from TCB0 (see thermal.cpp for the driver)
 #define VPINPTT 10                // PTT input. 1 = TX.
+#define VPINHWAMPENABLE A5        // header pin for the gated amplifier enable, hardware trip mode only:
+                                  // driven by CCL LUT0 on PA3. The header is shared with PF3 (A5),
+                                  // which must stay an input.
+
+//
+// port level bit masks for the trip interrupt and the fast shutdown path
+// these must match the pin numbers above (Nano Every pin mapping)
+//
+#define VPORTPSUENABLEBIT PIN0_bm             // VPINPSUENABLE (PA0) in VPORTA
+#define VPORTAMPENABLEBIT PIN1_bm             // VPINAMPENABLE (PA1) in VPORTA
+#define VPORTPSUENABLEBITPOS PIN0_bp          // bit numbers of the same, for the trip interrupt entry code
+#define VPORTAMPENABLEBITPOS PIN1_bp
+#define VPORTCURRENTCOMPBIT PIN0_bm           // VPINCURRENTCOMP (PE0) in VPORTE
+#define VPORTVOLTAGECOMPBIT PIN1_bm           // VPINVOLTAGECOMP (PE1) in VPORTE
+#define VPORTREVPOWERSRBIT PIN3_bm            // VPINREVPOWERSR (PE3) in VPORTE
 
 
 #endif //not defined
@@ -68,3 +68,12 @@ void TimeSecondTick(void)
   Str[Pos++] = 0;
   DisplaySetOnTime(Str);
 }
+
+
+//
+// get the on time in seconds since power on
+//
+unsigned long GetOnTimeSeconds(void)
+{
+  return ((unsigned long)GHours * 3600) + ((unsigned int)GMinutes * 60) + GSeconds;
+}
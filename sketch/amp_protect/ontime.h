@@ -28,6 +28,12 @@ void OnTimeInit(void);
 void TimeSecondTick(void);
 
 
+//
+// get the on time in seconds since power on
+//
+unsigned long GetOnTimeSeconds(void);
+
+
 
 
 #endif //__ONTIME_H
@@ -17,6 +17,14 @@
 #include "cathandler.h"
 #include "analogueio.h"
 #include "configdata.h"
+#include "triplatency.h"
+#include "hwtrip.h"
+#include "flightrecorder.h"
+#include "eventlog.h"
+#include "thermal.h"
+#include "scheduler.h"
+#include "fwdexcess.h"
+#include "tripstub.h"
 
 
 //
@@ -35,64 +43,346 @@ enum EProtectionState
 
 #define VINITCOUNT 550                  // 5.5 seconds count
 #define VCOMPARATORPINS 3               // pins PE00 & PE01
+#define VNUMTRIPCAUSES 6                // number of ETripCause values including eNoTrip
+
+//
+// ZZZA CAT bit for each trip cause, in ETripCause order
+//
+const byte GTripCauseBits[VNUMTRIPCAUSES] = {0, VCURRENTTRIP, VVOLTSGETRIP, VTEMPTRIP, VFWDPOWERTRIP, VREVPOWERTRIP};
 
 //
 // global variables
 //
 EProtectionState GProtectionState;      // sequencer state variable
 int GInitialiseCounter;                 // counts down 5s after startup
-ETripCause GTripCause;                  // reason for trip
-bool GTempResettable;                   // if true can't reset until temp lowered
-bool GPowerResettable;                  // if true can't reset until forward power lowered
+volatile ETripCause GTripCause;         // first cause to trip
+volatile byte GTripMask;                // all latched trip causes (ZZZA bit encoding)
+unsigned long GTripTime[VNUMTRIPCAUSES];  // micros() when each cause latched
+bool GRuleTripActive;                   // true if any trip rule is active: can't reset
 bool GResettable;                       // true if radio will allow a RESET button press
 bool GResetActivated;                   // true if reset button has been activated
 bool GProtectionEnforced;               // true if protection is enforced
 
-#define VTRIPTEMPTHRESHOLD 900          // 90C to trip
-#define VTTRIPTEMPREENABLE 500          // re-enable at 50C
-#define VFANONTHRESHOLD 400             // fan on at 40C
-#define VFANOFFTHRESHOLD 300            // off at 30C
-#define VTRIPFWDPOWERTHRESHOLD 1500     // forward power trip, in watts
-#define VTTRIPPOWERREENABLE 40          // forward power re-enable level, in watts (should be 0 if tripped anyway)
+//
+// trip interrupt timestamp, read inline by the trip interrupt for each newly seen input
+// position in the 10ms tick: tick count and tick timer (TCB2, 4us per count). The tick interrupt
+// can't run during the trip interrupt, so if its flag is set the tick count may be one behind.
+// (the tick interrupt updates the count and clears the flag with interrupts off, so the level 1
+// trip interrupt never sees one done without the other)
+// (the latency timer wraps in 32us: far less than the time a trip can wait for ProtectTick)
+//
+struct STripStamp
+{
+  byte Tick;                            // GTickCount
+  byte TickFlags;                       // TCB2.INTFLAGS
+  unsigned int Count;                   // TCB2.CNT
+#ifdef VTIMETRIPLATENCY
+  bool Timed;                           // true if the outputs were written
+  byte EntryTime;                       // latency timestamps
+  byte WriteTime;
+#endif
+};
+
+volatile byte GTripPendingFlags;        // port E flags seen by the trip interrupt, not yet latched
+STripStamp GTripStamps[VNUMLATENCYPATHS];  // timestamp of each pending input, in ELatencyPath order
+
+//
+// protection rules
+// each rule compares one input channel against a trip level and a re-enable level (hysteresis)
+// the levels are tunable config parameters: see EConfigParam in configdata.h
+// to supervise something new, add a channel (if needed) and a table entry
+//
+enum ERuleChannel
+{
+  eRuleTemperature,                     // heatsink temperature, 1DP C
+  eRulePSUVolts,                        // PSU voltage, 1DP
+  eRuleCurrent,                         // drain current, 1DP
+  eRuleFwdPower,                        // forward power, watts
+  eRuleRevPower,                        // reverse power, watts
+  eRuleFwdExcess,                       // derived: mean forward power excess over the limit, watts
+  eRuleSWR                              // derived: SWR, 2DP (reads 1.00 below the forward power gate)
+};
+#define VNUMRULECHANNELS 7
+
+
+enum ERuleDirection
+{
+  eRuleHigh,                            // over above the trip level, clears below the re-enable level
+  eRuleLow                              // over below the trip level, clears above the re-enable level
+};
+
+
+enum ERuleAction
+{
+  eActionNone,                          // evaluated, but no action
+  eActionTrip,                          // trip: latch cause, deassert enables, block reset while active
+  eActionFan                            // fan enabled while active (speed set in thermal.cpp)
+};
+
+
+struct SProtectRule
+{
+  ERuleChannel Channel;                 // input
+  ERuleDirection Direction;             // which side of the trip level is "over"
+  EConfigParam TripLevel;               // parameter holding the trip level
+  EConfigParam ReenableLevel;           // parameter holding the re-enable level
+  byte DebounceTicks;                   // ticks over the trip level before active
+  ERuleAction Action;                   // what to do while active
+  ETripCause Cause;                     // cause to latch for a trip
+};
+
+
+//
+// the rule table
+// forward power trips on the integrated excess, not on single samples: an instantaneous
+// trip was tripping on SSB peaks on TX when drain current was in spec
+// SWR is debounced over 5 ticks and latches as a reverse power trip: it is the early warning
+// for the same fault as the hardware reverse power comparator
+//
+#define VNUMPROTECTRULES 4
+const SProtectRule GProtectRules[VNUMPROTECTRULES] = 
+{
+  {eRuleTemperature, eRuleHigh, eParamTripTemp, eParamTempReenable, 1, eActionTrip, eTripTemperature},
+  {eRuleFwdExcess, eRuleHigh, eParamFwdExcessTrip, eParamFwdExcessReenable, 1, eActionTrip, eTripFwdPower},
+  {eRuleSWR, eRuleHigh, eParamTripSWR, eParamSWRReenable, 5, eActionTrip, eTripRevPower},
+  {eRuleTemperature, eRuleHigh, eParamFanOn, eParamFanOff, 1, eActionFan, eNoTrip}
+};
+
+
+//
+// state of each rule
+//
+struct SRuleState
+{
+  byte OverCount;                       // consecutive ticks over the trip level
+  bool Active;                          // true if tripped, until re-enabled
+};
+
+SRuleState GRuleStates[VNUMPROTECTRULES];
+long GFwdExcessIntegral;                // leaky integral of forward power excess (watt-ticks)
 
 
 
-void CurrentComparatorHandler(void)
+//
+// return the ZZZA CAT bit for a trip cause (0 for eNoTrip)
+//
+byte TripCauseBit(ETripCause Cause)
+{
+  return GTripCauseBits[Cause];
+}
+
+
+//
+// latch a trip cause with the time (micros()) it happened
+// each cause is timestamped when it first latches; the first cause of all is remembered.
+// main code only: the trip interrupt leaves its causes pending (see LatchPendingTrips())
+//
+void LatchTripCause(ETripCause Cause, unsigned long Time)
 {
-  GTripCause = eTripCurrent;
-  if(GProtectionEnforced)
+  byte Bit;
+
+  Bit = GTripCauseBits[Cause];
+  if ((Bit != 0) && ((GTripMask & Bit) == 0))
   {
-// deassert enable outputs
-    digitalWrite(VPINAMPENABLE, LOW);
-    digitalWrite(VPINPSUENABLE, LOW);
+    GTripTime[Cause] = Time;
+    GTripMask |= Bit;
+    if (GTripCause == eNoTrip)
+    {
+      GTripCause = Cause;
+      FlightRecorderTrigger();                    // keep the history leading up to the first cause
+    }
   }
 }
 
 
-void VoltageComparatorHandler(void)
+//
+// latch a trip cause that has just been found
+//
+void RecordTripCause(ETripCause Cause)
+{
+  LatchTripCause(Cause, micros());
+}
+
+
+//
+// clear all latched trip causes
+//
+void ClearTripCauses(void)
+{
+  noInterrupts();
+  GTripMask = 0;
+  GTripCause = eNoTrip;
+  interrupts();
+}
+
+
+//
+// read the time (micros()) that a cause first latched since the last reset
+//
+unsigned long GetTripTime(ETripCause Cause)
+{
+  unsigned long Time;
+
+  noInterrupts();
+  Time = GTripTime[Cause];
+  interrupts();
+  return Time;
+}
+
+
+//
+// hardware trip interrupt handler
+// the three comparator inputs are all on port E, so one direct vector handles them all
+// (attachInterrupt is not used, so the core's dispatching PORTE handler is not linked).
+// it is the level 1 (high priority) vector, so other interrupt handlers don't delay it.
+// the vector runs the entry code in tripstub.h: with no prologue, the enable outputs are
+// deasserted by single cbi instructions 8 and 10 cycles after the interrupt request.
+// the rest of the handler makes no calls, so the compiler only saves the registers it uses:
+// the port flags are added to a pending mask, and each newly seen input gets a timestamp.
+// The causes are latched by LatchPendingTrips() at the next ProtectTick.
+// if VTIMETRIPLATENCY is defined, the entry code isn't used: the handler is all C, so that
+// the timer can be read before the outputs are written.
+//
+#ifdef VTIMETRIPLATENCY
+ISR(PORTE_PORT_vect)
+#else
+ISR(PORTE_PORT_vect, ISR_NAKED)
 {
-  GTripCause = eTripPSUVoltage;
-  if(GProtectionEnforced)
+  asm volatile (VTRIPSTUBASM
+                :
+                : [gpior] "I" (_SFR_IO_ADDR(GPIOR0)), [enforced] "I" (VGPIORENFORCEDBITPOS),
+                  [porta] "I" (_SFR_IO_ADDR(VPORTA_OUT)), [amp] "I" (VPORTAMPENABLEBITPOS),
+                  [psu] "I" (VPORTPSUENABLEBITPOS));
+}
+
+ISR(TRIPBODY_vect, __attribute__((used)))        // only jumped to from the asm, so must be kept
+#endif
+{
+  byte Flags;
+  byte NewFlags;
+  STripStamp Stamp;
+#ifdef VTIMETRIPLATENCY
+  Stamp.EntryTime = LATENCYTIMESTAMP();
+  if (GPIOR0 & (1 << VGPIORENFORCEDBITPOS))
   {
-// deassert enable outputs
-    digitalWrite(VPINAMPENABLE, LOW);
-    digitalWrite(VPINPSUENABLE, LOW);
+    VPORTA.OUT &= ~VPORTAMPENABLEBIT;             // deassert VPINAMPENABLE
+    VPORTA.OUT &= ~VPORTPSUENABLEBIT;             // deassert VPINPSUENABLE
   }
+  Stamp.WriteTime = LATENCYTIMESTAMP();
+  Stamp.Timed = GProtectionEnforced;
+#endif
+  Stamp.Count = TCB2.CNT;
+  Stamp.TickFlags = TCB2.INTFLAGS;
+  Stamp.Tick = GTickCount;
+  Flags = VPORTE.INTFLAGS;
+  VPORTE.INTFLAGS = Flags;                        // clear the flags we are handling
+
+  NewFlags = Flags & ~GTripPendingFlags;          // keep the time of the first edge on each input
+  GTripPendingFlags |= Flags;
+  if (NewFlags & VPORTCURRENTCOMPBIT)
+    GTripStamps[eLatencyCurrent] = Stamp;
+  if (NewFlags & VPORTVOLTAGECOMPBIT)
+    GTripStamps[eLatencyVoltage] = Stamp;
+  if (NewFlags & VPORTREVPOWERSRBIT)
+    GTripStamps[eLatencyRevPower] = Stamp;
 }
 
-void SRFlipFlopTripHandler(void)
+
+//
+// find how long ago (in tick timer counts) a trip interrupt timestamp was taken
+// Now is a timestamp taken the same way, with interrupts off. A tick count behind a pending
+// tick flag is corrected only if the timer count has wrapped (is in the first half of the tick).
+//
+long TripStampAge(STripStamp* Stamp, STripStamp* Now)
+{
+  unsigned int Period;
+  byte StampTick, NowTick;
+
+  Period = TCB2.CCMP + 1;
+  StampTick = Stamp->Tick;
+  if ((Stamp->TickFlags & TCB_CAPT_bm) && (Stamp->Count < (Period / 2)))
+    StampTick++;
+  NowTick = Now->Tick;
+  if ((Now->TickFlags & TCB_CAPT_bm) && (Now->Count < (Period / 2)))
+    NowTick++;
+  return (long)(byte)(NowTick - StampTick) * Period + (long)Now->Count - (long)Stamp->Count;
+}
+
+
+//
+// latch the trip causes left pending by the trip interrupt
+// called at the start of ProtectTick. Each cause gets the micros() time of its first edge;
+// causes are latched oldest first, so the first cause is the first input to trip.
+// (if two inputs tripped in the same interrupt, reverse power is first, then current)
+//
+void LatchPendingTrips(void)
 {
-  GTripCause = eTripRevPower;
-  if(GProtectionEnforced)
+  byte Flags;
+  STripStamp Stamps[VNUMLATENCYPATHS];
+  STripStamp Now;
+  unsigned long NowMicros;
+  long Age[VNUMLATENCYPATHS];
+  bool Pending[VNUMLATENCYPATHS];
+  const ETripCause Causes[VNUMLATENCYPATHS] = {eTripCurrent, eTripPSUVoltage, eTripRevPower};
+  byte Path, Oldest;
+  byte Cntr;
+
+  noInterrupts();
+  Flags = GTripPendingFlags;
+  GTripPendingFlags = 0;
+  memcpy(Stamps, GTripStamps, sizeof(Stamps));
+  Now.Count = TCB2.CNT;
+  Now.TickFlags = TCB2.INTFLAGS;
+  Now.Tick = GTickCount;
+  NowMicros = micros();
+  interrupts();
+
+  Pending[eLatencyCurrent] = ((Flags & VPORTCURRENTCOMPBIT) != 0);
+  Pending[eLatencyVoltage] = ((Flags & VPORTVOLTAGECOMPBIT) != 0);
+  Pending[eLatencyRevPower] = ((Flags & VPORTREVPOWERSRBIT) != 0);
+  for (Path = 0; Path < VNUMLATENCYPATHS; Path++)
+    Age[Path] = TripStampAge(Stamps + Path, &Now);
+//
+// latch oldest first; the search order breaks ties: reverse power, current, voltage
+//
+  for (Cntr = 0; Cntr < VNUMLATENCYPATHS; Cntr++)
   {
-// deassert enable outputs
-    digitalWrite(VPINAMPENABLE, LOW);
-    digitalWrite(VPINPSUENABLE, LOW);
+    Oldest = VNUMLATENCYPATHS;
+    if (Pending[eLatencyRevPower])
+      Oldest = eLatencyRevPower;
+    for (Path = 0; Path < eLatencyRevPower; Path++)
+      if (Pending[Path] && ((Oldest == VNUMLATENCYPATHS) || (Age[Path] > Age[Oldest])))
+        Oldest = Path;
+    if (Oldest != VNUMLATENCYPATHS)
+    {
+      Pending[Oldest] = false;
+      LatchTripCause(Causes[Oldest], NowMicros - (unsigned long)Age[Oldest] * 4);   // 4us per count
+#ifdef VTIMETRIPLATENCY
+      if (Stamps[Oldest].Timed)
+        RecordTripLatency((ELatencyPath)Oldest, Stamps[Oldest].EntryTime, Stamps[Oldest].WriteTime);
+#endif
+    }
   }
 }
 
 
 
+//
+// enable the port E pin change interrupts for the trip inputs
+// current and voltage comparators are high if tripped; the SR flip flop is low if tripped
+// the pullups set by pinMode() are kept
+//
+void EnableTripInterrupts(void)
+{
+  CPUINT.LVL1VEC = PORTE_PORT_vect_num;           // level 1: pre-empts all other handlers
+  VPORTE.INTFLAGS = VPORTCURRENTCOMPBIT | VPORTVOLTAGECOMPBIT | VPORTREVPOWERSRBIT;
+  PORTE.PIN0CTRL = (PORTE.PIN0CTRL & ~PORT_ISC_gm) | PORT_ISC_RISING_gc;
+  PORTE.PIN1CTRL = (PORTE.PIN1CTRL & ~PORT_ISC_gm) | PORT_ISC_RISING_gc;
+  PORTE.PIN3CTRL = (PORTE.PIN3CTRL & ~PORT_ISC_gm) | PORT_ISC_FALLING_gc;
+}
+
+
+
 //
 // protect initialise
 // startup logic. This is called after the analogue thresholds are driven out.
@@ -101,12 +391,13 @@ void ProtectInit(void)
 {
   GProtectionState = eNotInitialised;
   GInitialiseCounter = VINITCOUNT;
-  GTripCause = eNoTrip;
+  ClearTripCauses();
+  FlightRecorderArm();
 
 //
 // turn on enforcement of protection if the PIN has been set
 //
-  if (GPin != 0)
+  if (GConfig.Pin != 0)
     EnforceProtection(true);
   else
     EnforceProtection(false);
@@ -119,20 +410,22 @@ void ProtectInit(void)
 //
   digitalWrite(VPINSRRESET, HIGH);            // reset the flip flop
   digitalWrite(VPINSRRESET, LOW);
+  if(digitalRead(VPINREVPOWERSR)==LOW)        // check if flip flop for rev power already over limit
+    RecordTripCause(eTripRevPower);
   if(digitalRead(VPINCURRENTCOMP)==HIGH)      // check if current already over limit
-    GTripCause = eTripCurrent;
+    RecordTripCause(eTripCurrent);
   if(digitalRead(VPINVOLTAGECOMP)==HIGH)      // check if PSU voltage already over limit
-    GTripCause = eTripPSUVoltage;
-  if(digitalRead(VPINREVPOWERSR)==LOW)        // check if flip flop for rev power already over limit
-    GTripCause = eTripRevPower;
+    RecordTripCause(eTripPSUVoltage);
 //
 // while PSU still off, set the "zero" current reading (there is a deliberate 0.5V bias from ACS723)
 // and attach interrupts
 //
   SetZeroCurrent();                         // read zero while drain supply still off
-  attachInterrupt(digitalPinToInterrupt(VPINCURRENTCOMP), CurrentComparatorHandler, RISING);
-  attachInterrupt(digitalPinToInterrupt(VPINVOLTAGECOMP), VoltageComparatorHandler, RISING);
-  attachInterrupt(digitalPinToInterrupt(VPINREVPOWERSR), SRFlipFlopTripHandler, FALLING);
+  TripLatencyInit();                        // clear latency statistics before handlers can run
+  EnableTripInterrupts();
+#ifdef VHARDWARETRIP
+  HardwareTripInit();                       // amplifier enable is still low here
+#endif
 
 //
 // if there is a trip cause, just wait for now: the cause is set and will enter tripped in the sequencer
@@ -152,8 +445,8 @@ void DisplayResetPressed(void)
 {
   if (GResettable)                              // if we meet the conditions - begin reset
   {
-    SetZeroCurrent();                           // re-read zero while drain supply still off
-    GTripCause = eNoTrip;
+    ClearTripCauses();
+    FlightRecorderArm();                        // capture no longer needed
     GProtectionState = eTripResetPressed;
     digitalWrite(VPINPSUENABLE, HIGH);          // turn PSU back on
   }
@@ -161,55 +454,135 @@ void DisplayResetPressed(void)
 
 
 //
-// forward power check (called from h/w driver)
-// parameter is forward power, integer
-// note forward power trip condition removed temporarily. Radio was tripping on TX when drain current in spec
+// forward power excess detector: the mean forward power excess over the limit, in watts
+// (see fwdexcess.h)
 //
-void CheckFwdPower(int Power)
+int UpdateFwdExcess(int Power)
 {
-//  if (Power > VTRIPFWDPOWERTHRESHOLD)
-//  {
-//    if (GTripCause == eNoTrip)
-//      GTripCause = eTripFwdPower;
-// deassert enable outputs
-//      digitalWrite(VPINAMPENABLE, LOW);
-//      digitalWrite(VPINPSUENABLE, LOW);
-//      GPowerResettable = false;        // can't reset for temp
-// }
-//  else if (Power < VTTRIPPOWERREENABLE)
-//    GPowerResettable = true;
-  if (Power < VTTRIPPOWERREENABLE)
-    GPowerResettable = true;
+  return FwdExcessStep(&GFwdExcessIntegral, Power, GConfig.Param[eParamTripFwdPower], GConfig.Param[eParamFwdExcessTau]);
 }
 
 
+//
+// check a proposed value for a config parameter against every rule that uses it as a level
+// a high rule needs its trip level above its re-enable level, and a low rule below: equal levels
+// would remove the hysteresis, and crossed levels would make the rule trip the wrong way.
+// the other level is read from the edit copy, so to move both levels a long way the one
+// "outside" has to be changed first.
+// returns false if the value would cross or collapse any rule's levels
+//
+bool CheckProtectRuleLevels(EConfigParam Param, int Value)
+{
+  const SProtectRule* Rule;
+  byte Cntr;
+  int TripLevel, ReenableLevel;
+  bool Valid = true;
+
+  for (Cntr = 0; Cntr < VNUMPROTECTRULES; Cntr++)
+  {
+    Rule = GProtectRules + Cntr;
+    if ((Rule->TripLevel == Param) || (Rule->ReenableLevel == Param))
+    {
+      TripLevel = (Rule->TripLevel == Param) ? Value : GetConfigParam(Rule->TripLevel);
+      ReenableLevel = (Rule->ReenableLevel == Param) ? Value : GetConfigParam(Rule->ReenableLevel);
+      if (Rule->Direction == eRuleHigh)
+        Valid = Valid && (TripLevel > ReenableLevel);
+      else
+        Valid = Valid && (TripLevel < ReenableLevel);
+    }
+  }
+  return Valid;
+}
+
 
 //
-// temperature check (called from h/w driver)
-// parameter is temperature, 1dp fixed point (ie 10x temp)
-// check whether we have tripped, or can exit trip; then check fan setting
+// evaluate the protection rules, in one pass through the rule table
+// for each rule: a "high" rule is over when the value is above the trip level and clears below
+// the re-enable level; a "low" rule is the reverse. The direction is fixed in the rule table, so
+// changing the levels can't reverse a rule (SetConfigParam also refuses crossed levels).
+// a rule becomes active after it has been over for DebounceTicks consecutive ticks,
+// and stays active (hysteresis) until the value passes the re-enable level.
 //
-void CheckTemperature(int Temperature)
+void EvaluateProtectRules(void)
 {
-  if (Temperature > VTRIPTEMPTHRESHOLD)
+  SSensorSnapshot Snapshot;
+  int Inputs[VNUMRULECHANNELS];
+  const SProtectRule* Rule;
+  SRuleState* State;
+  byte Cntr;
+  int Value, TripLevel, ReenableLevel;
+  bool Over, Clear;
+  bool TripActive = false;
+  bool FanActive = false;
+
+  GetSensorSnapshot(&Snapshot);
+  Inputs[eRuleTemperature] = Snapshot.Temperature;
+  Inputs[eRulePSUVolts] = Snapshot.PSUVolts;
+  Inputs[eRuleCurrent] = Snapshot.Current;
+  Inputs[eRuleFwdPower] = Snapshot.FwdPower;
+  Inputs[eRuleRevPower] = Snapshot.RevPower;
+  Inputs[eRuleFwdExcess] = UpdateFwdExcess(Snapshot.FwdPower);
+  Inputs[eRuleSWR] = (Snapshot.SWR != 0) ? Snapshot.SWR : 100;
+
+  for (Cntr = 0; Cntr < VNUMPROTECTRULES; Cntr++)
   {
-    if (GTripCause == eNoTrip)
-      GTripCause = eTripTemperature;
-    if(GProtectionEnforced)
+    Rule = GProtectRules + Cntr;
+    State = GRuleStates + Cntr;
+    Value = Inputs[Rule->Channel];
+    TripLevel = GConfig.Param[Rule->TripLevel];
+    ReenableLevel = GConfig.Param[Rule->ReenableLevel];
+    if (Rule->Direction == eRuleHigh)
+    {
+      Over = (Value > TripLevel);
+      Clear = (Value < ReenableLevel);
+    }
+    else
+    {
+      Over = (Value < TripLevel);
+      Clear = (Value > ReenableLevel);
+    }
+
+    if (Over)
+    {
+      if (State->OverCount < Rule->DebounceTicks)
+        State->OverCount++;
+      if (State->OverCount >= Rule->DebounceTicks)
+        State->Active = true;
+    }
+    else
+    {
+      State->OverCount = 0;
+      if (Clear)
+        State->Active = false;
+    }
+//
+// actions
+//
+    if (State->Active)
     {
-  // deassert enable outputs
-      digitalWrite(VPINAMPENABLE, LOW);
-      digitalWrite(VPINPSUENABLE, LOW);
+      switch (Rule->Action)
+      {
+        case eActionTrip:
+          TripActive = true;
+          RecordTripCause(Rule->Cause);
+          break;
+        case eActionFan:
+          FanActive = true;
+          break;
+        case eActionNone:
+          break;
+      }
     }
-      GTempResettable = false;        // can't reset for temp
   }
-  else if (Temperature < VTTRIPTEMPREENABLE)
-    GTempResettable = true;
 
-  if (Temperature > VFANONTHRESHOLD)
-    digitalWrite(VPINFAN, HIGH);
-  else if (Temperature < VFANOFFTHRESHOLD)
-    digitalWrite(VPINFAN, LOW);
+  if (TripActive && GProtectionEnforced)
+  {
+// deassert enable outputs
+    digitalWrite(VPINAMPENABLE, LOW);
+    digitalWrite(VPINPSUENABLE, LOW);
+  }
+  GRuleTripActive = TripActive;
+  SetFanEnable(FanActive);                        // fan speed is set by the thermal estimator
 }
 
 
@@ -229,14 +602,29 @@ void ProtectTick(void)
 
   if (digitalRead(VPINPTT)==HIGH)                 // first read the PTT
     PTTPressed = true;
+//
+// track the zero current offset whenever there should be no drain current; freeze it for TX
+//
+  SetZeroCurrentTracking(!PTTPressed && (GProtectionState != eTX));
+//
+// latch any trip causes seen by the trip interrupt, then evaluate the table driven
+// protection rules (eg temperature)
+//
+  LatchPendingTrips();
+  EvaluateProtectRules();
 
 //
 // see if it has been tripped (eg excessive temperature) - 
 // 
+#ifdef VHARDWARETRIP
+  if ((GTripCause == eNoTrip) && HardwareTripGateActive())
+    RecordTripCause(ReadHardwareTripCause());     // gate cut the amplifier but no interrupt cause seen
+#endif
   if ((GTripCause != eNoTrip) && (GProtectionState != eTripped) && (GProtectionEnforced == true))
   {
     GProtectionState = eTripped;                  // set new state
-    MakeAmplifierTripMessage(GTripCause, false);         // send CAT message
+    MakeAmplifierTripMessage(GTripMask, false);         // send CAT message
+    LogTripEvent(GTripMask);                      // persistent record of the trip
     SetDisplayPage(eTrippedPage);
     GResetActivated = false;                      // reset button not activated
   }
@@ -261,11 +649,8 @@ void ProtectTick(void)
       if (PTTPressed)
       {
         GProtectionState = eTX;
-        ClearPeakHolds();
         SetDisplayPage(eTXPage);
       }
-      else
-        SetZeroCurrent();                         // no PA current when in RX
       break;
       
     case eTX:                                     // "normal" TX. Check if TX ended
@@ -284,9 +669,7 @@ void ProtectTick(void)
 // Cycle the SR flip flop reset before testing it 
 //
       GResettable = true;                           // assume we can re-enable
-      if (GTempResettable == false)
-        GResettable = false;
-      if (GPowerResettable == false)
+      if (GRuleTripActive)
         GResettable = false;
       if(digitalRead(VPINCURRENTCOMP) == HIGH)
         GResettable = false;
@@ -305,19 +688,19 @@ void ProtectTick(void)
       {
         GResetActivated = true; 
         ActivateResetButton(true);                        // change text on reset button when ready
-        MakeAmplifierTripMessage(GTripCause, true);         // send CAT message
+        MakeAmplifierTripMessage(GTripMask, true);         // send CAT message
       }
       else if((GResettable == false) && (GResetActivated == true))
       {
         GResetActivated = false; 
         ActivateResetButton(false);                        // change text on reset button when ready
-        MakeAmplifierTripMessage(GTripCause, false);         // send CAT message
+        MakeAmplifierTripMessage(GTripMask, false);         // send CAT message
       }
       break;
 
     case eTripResetPressed:                       // complete the restoration of normal operation
       GProtectionState = eRX;
-      MakeAmplifierTripMessage(GTripCause, false);         // send CAT message
+      MakeAmplifierTripMessage(GTripMask, false);         // send CAT message
       digitalWrite(VPINAMPENABLE, HIGH);          // turn amplifier back on
       SetDisplayPage(eRXPage);
       break;
@@ -333,13 +716,20 @@ void ProtectTick(void)
 //
 void EnforceProtection(bool IsEnforced)
 {
-  GTripCause = eNoTrip;
+  ClearTripCauses();
   GProtectionEnforced = IsEnforced;
+  if (IsEnforced)                                 // bit tested by the trip interrupt entry code
+    GPIOR0 |= (1 << VGPIORENFORCEDBITPOS);
+  else
+    GPIOR0 &= ~(1 << VGPIORENFORCEDBITPOS);
 
   if(IsEnforced)
     SetPWMThresholds(false);
   else
     SetPWMThresholds(true);
+#ifdef VHARDWARETRIP
+  HardwareTripEnforce(IsEnforced);
+#endif
   DisplayResetPressed();
 }
 
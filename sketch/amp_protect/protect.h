@@ -15,6 +15,7 @@
 
 #include <Arduino.h>
 #include "display.h"
+#include "configdata.h"
 
 
 //
@@ -30,31 +31,30 @@ enum ETripCause
   eTripRevPower                         // excessive reverse power
 };
 
-extern ETripCause GTripCause;                  // reason for trip
+extern volatile ETripCause GTripCause;         // first cause to trip
+extern volatile byte GTripMask;                // all latched trip causes (ZZZA bit encoding)
 extern bool GProtectionEnforced;               // true if protection is enforced
 extern bool GResetActivated;                   // true if reset button has been activated
 
 
 
 //
-// protect initialise
-// startup logic
+// return the ZZZA CAT bit for a trip cause (0 for eNoTrip)
 //
-void ProtectInit(void);
+byte TripCauseBit(ETripCause Cause);
 
 
 //
-// temperature check (called from h/w driver)
-// parameter is temperature, 1dp fixed point (ie 10x temp)
+// read the time (micros()) that a cause first latched since the last reset
 //
-void CheckTemperature(int Temp);
+unsigned long GetTripTime(ETripCause Cause);
 
 
 //
-// forward power check (called from h/w driver)
-// parameter is forward power, integer
+// protect initialise
+// startup logic
 //
-void CheckFwdPower(int Power);
+void ProtectInit(void);
 
 
 //
@@ -81,4 +81,11 @@ void ProtectTick(void);
 void EnforceProtection(bool IsEnforced);
 
 
+//
+// check a proposed value for a config parameter against every protection rule that uses it
+// returns false if the value would cross or collapse a rule's trip and re-enable levels
+//
+bool CheckProtectRuleLevels(EConfigParam Param, int Value);
+
+
 #endif      // file sentry
@@ -0,0 +1,153 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// scheduler.cpp
+// this file holds the cooperative tick scheduler
+//
+// the tick ISR only increments a byte count. The scheduler extends it to a 16 bit tick number;
+// if it has moved on by more than one since the last pass, the extra ticks are counted as missed
+// (instead of being silently merged). Each task has a next due tick: a task is run when it is
+// due, then its next due tick steps on by its period. A task that has fallen a whole period
+// behind is counted as late and re-synchronised, so it doesn't run in a burst to catch up.
+// Tasks can't be pre-empted: a task still running when the next tick arrives is counted as an
+// overrun, and the lower priority tasks still to run are left for the next pass.
+// every task run is timed for the execution profile (see taskprofile.cpp).
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include "scheduler.h"
+#include "taskprofile.h"
+
+
+volatile byte GTickCount;                   // incremented by tick ISR
+byte GLastTickCount;                        // tick count at the last pass
+unsigned int GSchedulerTick;                // 16 bit tick number
+unsigned int GMissedTicks;
+unsigned int GProfileLatchTick;             // tick number at the start of the profile period
+
+
+struct STaskState
+{
+  unsigned int NextDue;                     // tick number when next due
+  unsigned int Overruns;                    // still running at the next tick
+  unsigned int LateRuns;                    // ran a period or more late
+};
+
+STaskState GTaskStates[VNUMTASKS];
+
+
+
+//
+// initialise - set every task's first due tick from its phase, and clear the counts
+//
+void SchedulerInit(void)
+{
+  byte Cntr;
+
+  GLastTickCount = GTickCount;
+  GSchedulerTick = 0;
+  GMissedTicks = 0;
+  GProfileLatchTick = 0;
+  TaskProfileInit();
+  for (Cntr = 0; Cntr < VNUMTASKS; Cntr++)
+  {
+    GTaskStates[Cntr].NextDue = GTasks[Cntr].Phase + 1;           // first pass is tick 1
+    GTaskStates[Cntr].Overruns = 0;
+    GTaskStates[Cntr].LateRuns = 0;
+  }
+}
+
+
+//
+// run one task, and step on its next due tick
+// returns true if a new tick arrived while it was running
+//
+bool RunTask(byte Task)
+{
+  STaskState* State;
+  byte Period;
+  unsigned long Start;
+  bool NewTick = false;
+
+  State = GTaskStates + Task;
+  Period = GTasks[Task].Period;
+  Start = micros();
+  GTasks[Task].Function();
+  RecordTaskTime((ETask)Task, micros() - Start);
+  if (GTickCount != GLastTickCount)
+  {
+    State->Overruns++;
+    NewTick = true;
+  }
+
+  State->NextDue += Period;
+  if ((int)(GSchedulerTick - State->NextDue) >= 0)               // still due: a period or more late
+  {
+    State->LateRuns++;
+    State->NextDue = GSchedulerTick + Period;
+  }
+  return NewTick;
+}
+
+
+//
+// called repeatedly from loop(): if one or more ticks have happened, run the tasks due
+// in priority order (then table order within a priority)
+//
+void SchedulerRun(void)
+{
+  byte Count;
+  byte Pending;
+  byte Priority;
+  byte Cntr;
+  bool NewTick = false;
+
+  Count = GTickCount;
+  Pending = Count - GLastTickCount;
+  if (Pending != 0)
+  {
+    GLastTickCount = Count;
+    GMissedTicks += Pending - 1;
+    GSchedulerTick += Pending;
+    if ((GSchedulerTick - GProfileLatchTick) >= VPROFILEPERIOD)
+    {
+      GProfileLatchTick = GSchedulerTick;
+      LatchTaskProfile();
+    }
+    for (Priority = 0; (Priority < VNUMPRIORITIES) && !NewTick; Priority++)
+      for (Cntr = 0; (Cntr < VNUMTASKS) && !NewTick; Cntr++)
+        if ((GTasks[Cntr].Priority == Priority) && ((int)(GSchedulerTick - GTaskStates[Cntr].NextDue) >= 0))
+          NewTick = RunTask(Cntr);
+  }
+}
+
+
+//
+// get the number of ticks that happened without a scheduler pass of their own
+//
+unsigned int GetMissedTicks(void)
+{
+  return GMissedTicks;
+}
+
+
+//
+// get the number of times a task was still running when the next tick arrived
+//
+unsigned int GetTaskOverruns(ETask Task)
+{
+  return GTaskStates[Task].Overruns;
+}
+
+
+//
+// get the number of times a task ran a whole period or more late
+//
+unsigned int GetTaskLateRuns(ETask Task)
+{
+  return GTaskStates[Task].LateRuns;
+}
@@ -0,0 +1,99 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// scheduler.h
+// this file holds the cooperative tick scheduler: a static table of tasks, each with
+// a period, phase and priority, run from loop()
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <Arduino.h>
+
+
+//
+// the tasks, in the order of the task table (see amp_protect.ino)
+//
+enum ETask
+{
+  eTaskConfig,                              // apply settings changes
+  eTaskAnalogue,                            // read analogue inputs
+  eTaskProtect,                             // protection sequencer
+  eTaskThermal,                             // thermal forecast and fan
+  eTaskHeartbeat,                           // heartbeat LED and on time
+  eTaskCAT,                                 // CAT serial input
+  eTaskEEPROM,                              // background EEPROM writes
+  eTaskDisplay                              // display update and touch events
+};
+#define VNUMTASKS 8
+
+
+//
+// priorities: 0 is the highest. In each pass, due tasks are run highest priority first.
+// if a new tick arrives during a pass, the rest of the pass is abandoned and the next pass starts
+// from the highest priority again: the skipped tasks stay due and run late.
+//
+#define VPRIORITYPROTECT 0                  // protection: runs every tick
+#define VPRIORITYCONTROL 1                  // slow control outputs
+#define VPRIORITYCOMMS 2                    // CAT
+#define VPRIORITYBACKGROUND 3               // display and EEPROM
+#define VNUMPRIORITIES 4
+
+
+struct STask
+{
+  void (*Function)(void);                   // task function
+  byte Period;                              // ticks between runs (max 127)
+  byte Phase;                               // tick offset of first run, to spread tasks over ticks
+  byte Priority;
+};
+
+
+//
+// the task table, indexed by ETask (defined in amp_protect.ino)
+//
+extern const STask GTasks[VNUMTASKS];
+
+
+//
+// tick count, incremented by the 10ms tick ISR
+//
+extern volatile byte GTickCount;
+
+
+//
+// initialise - set every task's first due tick from its phase, and clear the counts
+//
+void SchedulerInit(void);
+
+
+//
+// called repeatedly from loop(): if one or more ticks have happened, run the tasks due
+//
+void SchedulerRun(void);
+
+
+//
+// get the number of ticks that happened without a scheduler pass of their own
+//
+unsigned int GetMissedTicks(void);
+
+
+//
+// get the number of times a task was still running when the next tick arrived
+//
+unsigned int GetTaskOverruns(ETask Task);
+
+
+//
+// get the number of times a task ran a whole period or more late
+//
+unsigned int GetTaskLateRuns(ETask Task);
+
+
+#endif      // file sentry
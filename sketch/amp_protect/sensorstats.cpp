@@ -0,0 +1,251 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// sensorstats.cpp
+// this file holds the rolling statistics (min/max/mean/RMS) for each sensor value
+//
+// each window holds a ring of the VSTATSBLOCKS most recent blocks. A block summarises either
+// one sample (first window) or one complete window below it. When a window has received
+// VSTATSBLOCKS new blocks, its summary is pushed as one block into the next window up.
+// for each window:
+//   mean is kept as a running sum (add incoming, subtract outgoing block)
+//   max and min are kept in monotonic deques of ring indexes: the front is always the
+//   index of the largest (smallest) block in the window
+// so the cost per sample is O(1) (amortised over deque pops), whatever the window length.
+// RMS is only kept for the 100ms window: its blocks are single samples, so the running sum of
+// squares needs no per block storage. Keeping a mean square in every block of the longer
+// windows would cost another 600 bytes.
+// RAM (AVR): 91 bytes per window x 15 windows + 20 bytes of sums of squares = 1385 bytes
+// (it was 2025 bytes with a mean square in every block).
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include "sensorstats.h"
+
+
+//
+// summary of one block of samples
+//
+struct SStatsBlock
+{
+  int Min;
+  int Max;
+  int Mean;
+};
+
+
+//
+// one window: ring of blocks, running sums and min/max deques
+//
+struct SStatsWindow
+{
+  SStatsBlock Blocks[VSTATSBLOCKS];         // ring of the most recent blocks
+  byte Newest;                              // ring index of newest block
+  byte Count;                               // number of valid blocks (ramps up to VSTATSBLOCKS)
+  byte NewBlocks;                           // blocks added since the last push to the next window
+  long Sum;                                 // sum of block means
+  byte MaxDeque[VSTATSBLOCKS];              // ring indexes, largest block at front
+  byte MaxFront;
+  byte MaxCount;
+  byte MinDeque[VSTATSBLOCKS];              // ring indexes, smallest block at front
+  byte MinFront;
+  byte MinCount;
+};
+
+
+SStatsWindow GStats[VNUMSTATSCHANNELS][VNUMSTATSWINDOWS];
+unsigned long GStatsSumSquares[VNUMSTATSCHANNELS];  // sum of squares of the 100ms window's samples
+                                                    // (max 10 x 3106^2: fits 32 bits)
+
+
+
+//
+// initialise - clear all statistics
+//
+void StatsInit(void)
+{
+  memset(GStats, 0, sizeof(GStats));
+  memset(GStatsSumSquares, 0, sizeof(GStatsSumSquares));
+}
+
+
+
+//
+// helper to step a ring index on by one
+//
+byte NextIndex(byte Index)
+{
+  if (++Index >= VSTATSBLOCKS)
+    Index = 0;
+  return Index;
+}
+
+
+//
+// add a block to one window
+// if the ring is full the oldest block leaves: take it out of the sums, and off the front of 
+// the deques if it is there. Then drop any deque entries at the back that the new block beats.
+// returns true if the window has now had VSTATSBLOCKS new blocks, so should push to the next one
+//
+bool AddStatsBlock(SStatsWindow* Window, SStatsBlock* Block)
+{
+  byte Index;
+  byte Back;
+  SStatsBlock* Oldest;
+
+  Index = NextIndex(Window->Newest);                          // slot to write: oldest if ring is full
+  if (Window->Count == VSTATSBLOCKS)
+  {
+    Oldest = Window->Blocks + Index;
+    Window->Sum -= Oldest->Mean;
+    if ((Window->MaxCount != 0) && (Window->MaxDeque[Window->MaxFront] == Index))
+    {
+      Window->MaxFront = NextIndex(Window->MaxFront);
+      Window->MaxCount--;
+    }
+    if ((Window->MinCount != 0) && (Window->MinDeque[Window->MinFront] == Index))
+    {
+      Window->MinFront = NextIndex(Window->MinFront);
+      Window->MinCount--;
+    }
+  }
+  else
+    Window->Count++;
+
+  Window->Blocks[Index] = *Block;
+  Window->Newest = Index;
+  Window->Sum += Block->Mean;
+//
+// max deque: pop smaller entries from the back, then push
+//
+  while (Window->MaxCount != 0)
+  {
+    Back = (Window->MaxFront + Window->MaxCount - 1) % VSTATSBLOCKS;
+    if (Window->Blocks[Window->MaxDeque[Back]].Max > Block->Max)
+      break;
+    Window->MaxCount--;
+  }
+  Window->MaxDeque[(Window->MaxFront + Window->MaxCount) % VSTATSBLOCKS] = Index;
+  Window->MaxCount++;
+//
+// min deque: pop larger entries from the back, then push
+//
+  while (Window->MinCount != 0)
+  {
+    Back = (Window->MinFront + Window->MinCount - 1) % VSTATSBLOCKS;
+    if (Window->Blocks[Window->MinDeque[Back]].Min < Block->Min)
+      break;
+    Window->MinCount--;
+  }
+  Window->MinDeque[(Window->MinFront + Window->MinCount) % VSTATSBLOCKS] = Index;
+  Window->MinCount++;
+
+  if (++Window->NewBlocks >= VSTATSBLOCKS)
+  {
+    Window->NewBlocks = 0;
+    return true;
+  }
+  return false;
+}
+
+
+
+//
+// add a new sample for one channel (called once per tick for each channel)
+// the sample is a block in its own right in the first window; whenever a window completes
+// VSTATSBLOCKS new blocks, its summary becomes a block in the next window
+// the sum of squares for the 100ms window is updated first, while the oldest sample is still there
+//
+void AddStatsSample(EStatsChannel Channel, int Value)
+{
+  SStatsBlock Block;
+  SStatsWindow* Window;
+  byte WindowCntr;
+  int Oldest;
+
+  Window = &GStats[Channel][eStatsWindow100ms];
+  if (Window->Count == VSTATSBLOCKS)
+  {
+    Oldest = Window->Blocks[NextIndex(Window->Newest)].Mean;
+    GStatsSumSquares[Channel] -= (long)Oldest * (long)Oldest;
+  }
+  GStatsSumSquares[Channel] += (long)Value * (long)Value;
+
+  Block.Min = Value;
+  Block.Max = Value;
+  Block.Mean = Value;
+
+  for (WindowCntr = 0; WindowCntr < VNUMSTATSWINDOWS; WindowCntr++)
+  {
+    Window = &GStats[Channel][WindowCntr];
+    if (!AddStatsBlock(Window, &Block))
+      break;
+    Block.Min = Window->Blocks[Window->MinDeque[Window->MinFront]].Min;
+    Block.Max = Window->Blocks[Window->MaxDeque[Window->MaxFront]].Max;
+    Block.Mean = Window->Sum / VSTATSBLOCKS;
+  }
+}
+
+
+
+//
+// integer square root, by bit-by-bit method (no divide)
+//
+unsigned int IntSqrt(unsigned long Value)
+{
+  unsigned long Result = 0;
+  unsigned long Bit = 1UL << 30;
+
+  while (Bit > Value)
+    Bit >>= 2;
+  while (Bit != 0)
+  {
+    if (Value >= Result + Bit)
+    {
+      Value -= Result + Bit;
+      Result = (Result >> 1) + Bit;
+    }
+    else
+      Result >>= 1;
+    Bit >>= 2;
+  }
+  return (unsigned int)Result;
+}
+
+
+
+//
+// read a statistic for a channel over a window
+// returns 0 if no samples have been added yet, or for RMS over a window other than 100ms
+//
+int GetStatistic(EStatsChannel Channel, EStatsWindow Window, EStatsFunction Function)
+{
+  SStatsWindow* WindowPtr;
+  int Result = 0;
+
+  WindowPtr = &GStats[Channel][Window];
+  if (WindowPtr->Count != 0)
+  {
+    switch(Function)
+    {
+      case eStatsMin:
+        Result = WindowPtr->Blocks[WindowPtr->MinDeque[WindowPtr->MinFront]].Min;
+        break;
+      case eStatsMax:
+        Result = WindowPtr->Blocks[WindowPtr->MaxDeque[WindowPtr->MaxFront]].Max;
+        break;
+      case eStatsMean:
+        Result = WindowPtr->Sum / WindowPtr->Count;
+        break;
+      case eStatsRMS:
+        if (Window == eStatsWindow100ms)
+          Result = IntSqrt(GStatsSumSquares[Channel] / WindowPtr->Count);
+        break;
+    }
+  }
+  return Result;
+}
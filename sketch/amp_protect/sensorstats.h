@@ -0,0 +1,85 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// sensorstats.h
+// this file holds the rolling statistics (min/max/mean/RMS) for each sensor value
+// RAM use (AVR) is 1385 bytes: RMS is only kept for the 100ms window (see sensorstats.cpp)
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __SENSORSTATS_H
+#define __SENSORSTATS_H
+
+#include <Arduino.h>
+
+
+//
+// sensor channels that have statistics kept
+//
+enum EStatsChannel
+{
+  eStatsTemperature,                        // 1DP
+  eStatsPSUVolts,                           // 1DP
+  eStatsCurrent,                            // 1DP
+  eStatsFwdPower,                           // watts
+  eStatsRevPower                            // watts
+};
+#define VNUMSTATSCHANNELS 5
+
+
+//
+// statistics windows
+// each window is VSTATSBLOCKS blocks of the window below; the first is VSTATSBLOCKS ticks
+//
+enum EStatsWindow
+{
+  eStatsWindow100ms,                        // slides every tick
+  eStatsWindow1s,                           // slides every 100ms
+  eStatsWindow10s                           // slides every 1s
+};
+#define VNUMSTATSWINDOWS 3
+#define VSTATSBLOCKS 10
+
+
+//
+// statistic to read from a window
+//
+enum EStatsFunction
+{
+  eStatsMin,
+  eStatsMax,
+  eStatsMean,
+  eStatsRMS                                 // 100ms window only
+};
+
+
+
+//
+// initialise - clear all statistics
+//
+void StatsInit(void);
+
+
+//
+// add a new sample for one channel (called once per tick for each channel)
+//
+void AddStatsSample(EStatsChannel Channel, int Value);
+
+
+//
+// read a statistic for a channel over a window
+// returns 0 if no samples have been added yet, or for RMS over a window other than 100ms
+//
+int GetStatistic(EStatsChannel Channel, EStatsWindow Window, EStatsFunction Function);
+
+
+//
+// integer square root, by bit-by-bit method (no divide)
+//
+unsigned int IntSqrt(unsigned long Value);
+
+
+#endif      // file sentry
@@ -0,0 +1,135 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// taskprofile.cpp
+// this file holds the execution time profile of each scheduler task
+//
+// the scheduler timestamps entry and exit of every task run with micros(), and passes the
+// difference here. micros() is used rather than TCB0 (the trip latency timer) because TCB0
+// wraps after 32us, far shorter than most tasks. micros() reads
+// TCB3 (the Arduino core's millis timer) plus its overflow count, so has no limit.
+// times are held in microseconds, clipped to 65535.
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include "taskprofile.h"
+
+
+struct STaskProfile
+{
+  unsigned int Min;                         // current period
+  unsigned int Max;
+  unsigned long Sum;
+  unsigned int Count;
+  unsigned int LastMin;                     // last complete period
+  unsigned int LastAvg;
+  unsigned int LastMax;
+  unsigned int Worst;                       // since boot
+};
+
+STaskProfile GTaskProfiles[VNUMTASKS];
+
+
+
+//
+// initialise - clear all profile data
+//
+void TaskProfileInit(void)
+{
+  memset(GTaskProfiles, 0, sizeof(GTaskProfiles));
+  LatchTaskProfile();                                   // sets Min ready for the first period
+}
+
+
+//
+// record the execution time of one run of a task
+//
+void RecordTaskTime(ETask Task, unsigned long Micros)
+{
+  STaskProfile* Profile;
+  unsigned int Time;
+
+  Profile = GTaskProfiles + Task;
+  Time = (Micros > 0xFFFF) ? 0xFFFF : (unsigned int)Micros;
+  if (Time < Profile->Min)
+    Profile->Min = Time;
+  if (Time > Profile->Max)
+    Profile->Max = Time;
+  if (Time > Profile->Worst)
+    Profile->Worst = Time;
+  Profile->Sum += Time;
+  Profile->Count++;
+}
+
+
+//
+// end of a measurement period: latch the min/avg/max for each task and start again
+// a task that didn't run in the period reads 0
+//
+void LatchTaskProfile(void)
+{
+  STaskProfile* Profile;
+  byte Cntr;
+
+  for (Cntr = 0; Cntr < VNUMTASKS; Cntr++)
+  {
+    Profile = GTaskProfiles + Cntr;
+    Profile->LastMin = 0;
+    Profile->LastAvg = 0;
+    Profile->LastMax = 0;
+    if (Profile->Count != 0)
+    {
+      Profile->LastMin = Profile->Min;
+      Profile->LastAvg = Profile->Sum / Profile->Count;
+      Profile->LastMax = Profile->Max;
+    }
+    Profile->Min = 0xFFFF;
+    Profile->Max = 0;
+    Profile->Sum = 0;
+    Profile->Count = 0;
+  }
+}
+
+
+//
+// clear the worst case since boot for every task
+//
+void ClearTaskWorstCase(void)
+{
+  byte Cntr;
+
+  for (Cntr = 0; Cntr < VNUMTASKS; Cntr++)
+    GTaskProfiles[Cntr].Worst = 0;
+}
+
+
+//
+// read a profile statistic for a task, in microseconds
+//
+unsigned int GetTaskProfile(ETask Task, EProfileStat Stat)
+{
+  STaskProfile* Profile;
+  unsigned int Result = 0;
+
+  Profile = GTaskProfiles + Task;
+  switch (Stat)
+  {
+    case eProfileMin:
+      Result = Profile->LastMin;
+      break;
+    case eProfileAvg:
+      Result = Profile->LastAvg;
+      break;
+    case eProfileMax:
+      Result = Profile->LastMax;
+      break;
+    case eProfileWorst:
+      Result = Profile->Worst;
+      break;
+  }
+  return Result;
+}
@@ -0,0 +1,65 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// taskprofile.h
+// this file holds the execution time profile of each scheduler task
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __TASKPROFILE_H
+#define __TASKPROFILE_H
+
+#include <Arduino.h>
+#include "scheduler.h"
+
+
+#define VPROFILEPERIOD 100                  // ticks per min/avg/max measurement period (1s)
+
+
+//
+// statistic to read for a task. All are in microseconds.
+// min, avg and max are over the last complete measurement period.
+//
+enum EProfileStat
+{
+  eProfileMin,
+  eProfileAvg,
+  eProfileMax,
+  eProfileWorst                             // worst case since boot (or since cleared)
+};
+
+
+//
+// initialise - clear all profile data
+//
+void TaskProfileInit(void);
+
+
+//
+// record the execution time of one run of a task
+//
+void RecordTaskTime(ETask Task, unsigned long Micros);
+
+
+//
+// end of a measurement period: latch the min/avg/max for each task and start again
+//
+void LatchTaskProfile(void);
+
+
+//
+// clear the worst case since boot for every task
+//
+void ClearTaskWorstCase(void);
+
+
+//
+// read a profile statistic for a task, in microseconds
+//
+unsigned int GetTaskProfile(ETask Task, EProfileStat Stat);
+
+
+#endif      // file sentry
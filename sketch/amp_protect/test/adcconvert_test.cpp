@@ -0,0 +1,266 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// adcconvert_test.cpp
+// host test of the ADC reading conversions and lookup tables (adcconvert.h)
+// the Arduino IDE doesn't build files in test/. To build and run on a host:
+//   g++ -O2 -I.. -o adcconvert_test adcconvert_test.cpp && ./adcconvert_test
+// prints each case, and returns non zero if any fails
+//
+// every table entry is checked against the float (double) formula it replaces.
+// tolerances, in the units the sketch reports:
+//   power tables: entry is the formula truncated to whole watts: 0 or 1W below it
+//   power lookup of a 13 bit reading (interpolated): 0 to 2W below the formula
+//   temperature table: within 1 (0.1C) of the rounded, clipped formula
+//   reciprocal table: exact;  SWR, return loss tables: within 1 (0.01, 0.1dB) of the formula
+//   current, voltage: identical to the float calculation for every 10 bit reading; for
+//     13 bit readings within 1 (0.1A, 0.1V) of it (the multiplier is rounded, so a value
+//     just below a step can read the step above)
+// a benchmark then times the fixed point conversions against the float ones they replace.
+// The host times are only a guide to the ratio: on the AVR (no FPU) float is much slower still.
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include "adcconvert.h"
+
+
+#define VBENCHLOOPS 20000000L
+
+int GFailures = 0;
+volatile unsigned int GBenchResult;         // so the benchmark loop isn't optimised away
+
+
+//
+// report one case
+//
+void Check(const char* Name, bool Pass)
+{
+  printf("%s: %s\n", Pass ? "pass" : "FAIL", Name);
+  if (!Pass)
+    GFailures++;
+}
+
+
+//
+// check a 1024 entry power table, and the interpolated lookup of every 13 bit reading
+//
+void TestPowerTable(const char* Name, const int* Table, double Scale)
+{
+  int Reading;
+  double Exact, Error;
+  double MaxTableError = 0.0;
+  double MaxLookupError = 0.0;
+  bool TableOK = true;
+  bool LookupOK = true;
+  char Text[100];
+
+  for (Reading = 0; Reading < 1024; Reading++)
+  {
+    Exact = (double)Reading * Reading * Scale;
+    Error = Exact - Table[Reading];
+    if ((Error < -1E-3) || (Error >= 1.0 + 1E-3))
+      TableOK = false;
+    if (fabs(Error) > fabs(MaxTableError))
+      MaxTableError = Error;
+  }
+  snprintf(Text, sizeof(Text), "%s table, 1024 codes: max %.3fW below the formula", Name, MaxTableError);
+  Check(Text, TableOK);
+
+  for (Reading = 0; Reading <= (int)VADCMAXREADING; Reading++)
+  {
+    Exact = (double)Reading * Reading * Scale / (1 << (2 * VADCFRACBITS));
+    Error = Exact - LookupADCTable(Table, Reading);
+    if ((Error < -1E-3) || (Error >= 2.0 + 1E-3))
+      LookupOK = false;
+    if (fabs(Error) > fabs(MaxLookupError))
+      MaxLookupError = Error;
+  }
+  snprintf(Text, sizeof(Text), "%s lookup, 8185 13 bit readings: max %.3fW below the formula", Name, MaxLookupError);
+  Check(Text, LookupOK);
+}
+
+
+//
+// check the temperature table against the Steinhart-Hart formula, rounded and clipped
+//
+void TestTempTable(void)
+{
+  int Reading;
+  double Temp;
+  int Expected;
+  int Error;
+  int MaxError = 0;
+  char Text[100];
+
+  for (Reading = 0; Reading < 1024; Reading++)
+  {
+    if (Reading == 0)
+      Expected = VTEMPMIN;
+    else if (Reading == 1023)
+      Expected = VTEMPMAX;
+    else
+    {
+      Temp = log(2700.0 * (1024 - Reading) / Reading);
+      Temp = 10.0 * (1.0 / (1.13718015E-3 + 2.30516107E-4 * Temp + 1.18641457E-7 * Temp * Temp * Temp) - 273.15);
+      Expected = (int)lround(Temp);
+      if (Temp < VTEMPMIN)
+        Expected = VTEMPMIN;
+      else if (Temp > VTEMPMAX)
+        Expected = VTEMPMAX;
+    }
+    Error = abs(GTempTable[Reading] - Expected);
+    if (Error > MaxError)
+      MaxError = Error;
+  }
+  snprintf(Text, sizeof(Text), "temperature table, 1024 codes: max error %d (0.1C)", MaxError);
+  Check(Text, MaxError <= 1);
+}
+
+
+//
+// check the SWR tables against their formulas
+//
+void TestSWRTables(void)
+{
+  int Cntr;
+  long Expected;
+  int RecipErrors = 0;
+  int MaxSWRError = 0;
+  int MaxRLError = 0;
+  char Text[100];
+
+  for (Cntr = 128; Cntr < 256; Cntr++)
+  {
+    Expected = lround((double)(1L << VRECIPSHIFT) / Cntr);
+    if ((long)GRecipTable[Cntr - 128] != Expected)
+      RecipErrors++;
+  }
+  snprintf(Text, sizeof(Text), "reciprocal table, 128 mantissas: %d errors", RecipErrors);
+  Check(Text, RecipErrors == 0);
+
+  for (Cntr = 0; Cntr < 256; Cntr++)
+  {
+    Expected = lround(100.0 * (256 + Cntr) / (256 - Cntr));
+    if (Expected > VSWRMAX)
+      Expected = VSWRMAX;
+    if (labs((long)GSWRTable[Cntr] - Expected) > MaxSWRError)
+      MaxSWRError = labs((long)GSWRTable[Cntr] - Expected);
+
+    Expected = VRETURNLOSSMAX;
+    if ((Cntr != 0) && (-200.0 * log10(Cntr / 256.0) <= VRETURNLOSSMAX))
+      Expected = lround(-200.0 * log10(Cntr / 256.0));
+    if (labs((long)GReturnLossTable[Cntr] - Expected) > MaxRLError)
+      MaxRLError = labs((long)GReturnLossTable[Cntr] - Expected);
+  }
+  snprintf(Text, sizeof(Text), "SWR table, 256 codes: max error %d (0.01)", MaxSWRError);
+  Check(Text, MaxSWRError <= 1);
+  snprintf(Text, sizeof(Text), "return loss table, 256 codes: max error %d (0.1dB)", MaxRLError);
+  Check(Text, MaxRLError <= 1);
+}
+
+
+//
+// float calculations that the fixed point current and voltage conversions replace
+// (10x value, truncated when stored to the unsigned int sensor variable)
+//
+unsigned int FloatCurrent(int Reading)
+{
+  unsigned int Current = 0;
+
+  if (Reading > 0)
+    Current = (unsigned int)((float)Reading / (1 << VADCFRACBITS) * VCURRENTSCALE * 10.0);
+  return Current;
+}
+
+unsigned int FloatVoltage(unsigned int Reading)
+{
+  return (unsigned int)((float)Reading / (1 << VADCFRACBITS) * VVOLTAGESCALE * 10.0);
+}
+
+
+//
+// check current and voltage for every 13 bit reading
+//
+void TestCurrentVoltage(void)
+{
+  int Reading;
+  int Error;
+  int TenBitErrors[2] = {0, 0};
+  bool ReadingOK[2] = {true, true};
+  char Text[100];
+
+  for (Reading = -64; Reading <= (int)VADCMAXREADING; Reading++)
+  {
+    Error = (int)FloatCurrent(Reading) - (int)CurrentFromADC(Reading);
+    if (((Reading & VADCFRACMASK) == 0) && (Error != 0))
+      TenBitErrors[0]++;
+    if ((Error < -1) || (Error > 1) || ((Reading <= 0) && (CurrentFromADC(Reading) != 0)))
+      ReadingOK[0] = false;
+    if (Reading >= 0)
+    {
+      Error = (int)FloatVoltage(Reading) - (int)VoltageFromADC(Reading);
+      if (((Reading & VADCFRACMASK) == 0) && (Error != 0))
+        TenBitErrors[1]++;
+      if ((Error < -1) || (Error > 1))
+        ReadingOK[1] = false;
+    }
+  }
+  snprintf(Text, sizeof(Text), "current: 1024 10 bit readings identical to float (%d differ)", TenBitErrors[0]);
+  Check(Text, TenBitErrors[0] == 0);
+  Check("current: every 13 bit reading within 0.1A, negative clipped to 0", ReadingOK[0]);
+  snprintf(Text, sizeof(Text), "voltage: 1024 10 bit readings identical to float (%d differ)", TenBitErrors[1]);
+  Check(Text, TenBitErrors[1] == 0);
+  Check("voltage: every 13 bit reading within 0.1V", ReadingOK[1]);
+}
+
+
+//
+// time one conversion method over every 13 bit reading, repeatedly
+// returns ns per conversion
+//
+double TimeConversion(bool IsFixed)
+{
+  clock_t Start;
+  unsigned int Sum = 0;
+  long Cntr;
+  unsigned int Reading;
+
+  Start = clock();
+  for (Cntr = 0; Cntr < VBENCHLOOPS; Cntr++)
+  {
+    Reading = Cntr & 0x1FFF;
+    if (IsFixed)
+      Sum += CurrentFromADC(Reading) + VoltageFromADC(Reading) + LookupADCTable(GFwdPowerTable, Reading);
+    else
+      Sum += FloatCurrent(Reading) + FloatVoltage(Reading) +
+             (unsigned int)((float)Reading * (float)Reading * VFWDPOWERSCALE / (1 << (2 * VADCFRACBITS)));
+  }
+  GBenchResult = Sum;
+  return (double)(clock() - Start) * 1E9 / CLOCKS_PER_SEC / VBENCHLOOPS;
+}
+
+
+int main(void)
+{
+  double FixedTime, FloatTime;
+
+  TestPowerTable("forward power", GFwdPowerTable, VFWDPOWERSCALE);
+  TestPowerTable("reverse power", GRevPowerTable, VREVPOWERSCALE);
+  TestTempTable();
+  TestSWRTables();
+  TestCurrentVoltage();
+
+  FixedTime = TimeConversion(true);
+  FloatTime = TimeConversion(false);
+  printf("benchmark: current + voltage + forward power per reading: fixed point %.2fns, float %.2fns\n",
+         FixedTime, FloatTime);
+
+  printf("%d failures\n", GFailures);
+  return (GFailures == 0) ? 0 : 1;
+}
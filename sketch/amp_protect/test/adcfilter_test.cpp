@@ -0,0 +1,265 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// adcfilter_test.cpp
+// host test of the ADC reading filter stage (adcfilter.cpp)
+// the Arduino IDE doesn't build files in test/. To build and run on a host:
+//   g++ -O2 -I.. -o adcfilter_test adcfilter_test.cpp ../adcfilter.cpp && ./adcfilter_test
+// prints each case, and returns non zero if any fails
+//
+// checks: median glitch rejection and step delay; IIR step response against
+// 1 - (1 - 2^-k)^n, settling to exactly the input, and state range; the latency to 90% of a
+// step of each channel in GADCChannels (analogueio.cpp) against the latency stated there.
+// a benchmark then times one filter step for each channel setting, in host CPU cycles where
+// the cycle counter can be read (x86), otherwise in ns. Host cycles are not AVR cycles: use it
+// to compare the cost of the settings, and to see a change to the filter code hasn't slowed it.
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VHAVECYCLECOUNTER
+#endif
+#include "adcfilter.h"
+
+
+#define VLOW 1000                           // step test levels: 13 bit readings
+#define VHIGH 8000
+#define VTICKMS 10                          // one reading per tick
+#define VBENCHSAMPLES 10000000L
+
+int GFailures = 0;
+volatile unsigned int GBenchResult;         // so the benchmark loop isn't optimised away
+
+
+//
+// filter settings and stated latency of each channel. Must match GADCChannels in analogueio.cpp
+//
+struct SChannelFilter
+{
+  const char* Name;
+  unsigned char Median;
+  unsigned char IIRShift;
+  int LatencyMs;
+};
+
+const SChannelFilter GChannels[5] =
+{
+  {"current", 0, 0, 10},
+  {"forward power", 3, 0, 20},
+  {"reverse power", 3, 0, 20},
+  {"temperature", 5, 3, 200},
+  {"voltage", 3, 2, 100}
+};
+
+
+//
+// report one case
+//
+void Check(const char* Name, bool Pass)
+{
+  printf("%s: %s\n", Pass ? "pass" : "FAIL", Name);
+  if (!Pass)
+    GFailures++;
+}
+
+
+//
+// prime a filter at VLOW, then feed it Count readings from Readings
+// Output holds the filter output for each reading
+//
+void RunFilter(unsigned char Median, unsigned char IIRShift, const unsigned int* Readings, int Count, unsigned int* Output)
+{
+  SADCFilter Filter;
+  int Cntr;
+
+  memset(&Filter, 0, sizeof(Filter));
+  ADCFilterStep(&Filter, Median, IIRShift, VLOW);
+  for (Cntr = 0; Cntr < Count; Cntr++)
+    Output[Cntr] = ADCFilterStep(&Filter, Median, IIRShift, Readings[Cntr]);
+}
+
+
+//
+// number of readings after a step from VLOW to VHIGH before the output reaches 90% of it
+//
+int StepLatency(unsigned char Median, unsigned char IIRShift)
+{
+  unsigned int Readings[100];
+  unsigned int Output[100];
+  int Cntr;
+  int Latency = -1;
+
+  for (Cntr = 0; Cntr < 100; Cntr++)
+    Readings[Cntr] = VHIGH;
+  RunFilter(Median, IIRShift, Readings, 100, Output);
+  for (Cntr = 0; (Cntr < 100) && (Latency < 0); Cntr++)
+    if (Output[Cntr] >= VLOW + (VHIGH - VLOW) * 9 / 10)
+      Latency = Cntr + 1;
+  return Latency;
+}
+
+
+//
+// a glitch of GlitchLength readings at VHIGH, with a constant VLOW either side
+// returns true if the output never moved from VLOW
+//
+bool RejectsGlitch(unsigned char Median, int GlitchLength)
+{
+  unsigned int Readings[20];
+  unsigned int Output[20];
+  int Cntr;
+  bool Rejected = true;
+
+  for (Cntr = 0; Cntr < 20; Cntr++)
+    Readings[Cntr] = ((Cntr >= 5) && (Cntr < 5 + GlitchLength)) ? VHIGH : VLOW;
+  RunFilter(Median, 0, Readings, 20, Output);
+  for (Cntr = 0; Cntr < 20; Cntr++)
+    if (Output[Cntr] != VLOW)
+      Rejected = false;
+  return Rejected;
+}
+
+
+//
+// median filter: glitch rejection, and the delay it adds to a step
+//
+void TestMedian(void)
+{
+  Check("median 3 rejects a 1 reading glitch", RejectsGlitch(3, 1));
+  Check("median 3 passes a 2 reading pulse", !RejectsGlitch(3, 2));
+  Check("median 5 rejects a 2 reading glitch", RejectsGlitch(5, 2));
+  Check("median 5 passes a 3 reading pulse", !RejectsGlitch(5, 3));
+  Check("no median: step seen on the 1st reading", StepLatency(0, 0) == 1);
+  Check("median 3: step delayed by 1 reading", StepLatency(3, 0) == 2);
+  Check("median 5: step delayed by 2 readings", StepLatency(5, 0) == 3);
+}
+
+
+//
+// IIR: step response follows the single pole response (within 1, the truncation of the output),
+// reaches 90% in the stated number of readings, and settles to exactly the input
+//
+void TestIIR(void)
+{
+  const int Latency[VMAXIIRSHIFT + 1] = {1, 4, 9, 18};
+  unsigned int Readings[200];
+  unsigned int Output[200];
+  unsigned char Shift;
+  int Cntr;
+  double Expected;
+  double MaxError;
+  int Measured;
+  SADCFilter Filter;
+  char Name[100];
+
+  for (Cntr = 0; Cntr < 200; Cntr++)
+    Readings[Cntr] = VHIGH;
+  for (Shift = 1; Shift <= VMAXIIRSHIFT; Shift++)
+  {
+    RunFilter(0, Shift, Readings, 200, Output);
+    MaxError = 0.0;
+    for (Cntr = 0; Cntr < 200; Cntr++)
+    {
+      Expected = VHIGH - (VHIGH - VLOW) * pow(1.0 - 1.0 / (1 << Shift), Cntr + 1);
+      if (fabs(Output[Cntr] - Expected) > MaxError)
+        MaxError = fabs(Output[Cntr] - Expected);
+    }
+    snprintf(Name, sizeof(Name), "IIR k=%d: step response within %.2f of 1-(1-2^-k)^n (limit 1)", Shift, MaxError);
+    Check(Name, MaxError <= 1.0);
+    Measured = StepLatency(0, Shift);
+    snprintf(Name, sizeof(Name), "IIR k=%d: 90%% of a step after %d readings (stated %d)", Shift, Measured, Latency[Shift]);
+    Check(Name, Measured == Latency[Shift]);
+    snprintf(Name, sizeof(Name), "IIR k=%d: settles to exactly the input (%u)", Shift, Output[199]);
+    Check(Name, Output[199] == VHIGH);
+  }
+
+  memset(&Filter, 0, sizeof(Filter));
+  ADCFilterStep(&Filter, 0, VMAXIIRSHIFT, 0);
+  for (Cntr = 0; Cntr < 200; Cntr++)
+    ADCFilterStep(&Filter, 0, VMAXIIRSHIFT, 8184);
+  snprintf(Name, sizeof(Name), "IIR k=%d: state for full scale input is %u, fits 16 bits", VMAXIIRSHIFT, Filter.IIRState);
+  Check(Name, Filter.IIRState <= 0xFFFF);
+}
+
+
+//
+// each channel: latency to 90% of a step, in ms
+//
+void TestChannelLatency(void)
+{
+  int Channel;
+  int Measured;
+  char Name[100];
+
+  for (Channel = 0; Channel < 5; Channel++)
+  {
+    Measured = StepLatency(GChannels[Channel].Median, GChannels[Channel].IIRShift) * VTICKMS;
+    snprintf(Name, sizeof(Name), "%s channel: latency %dms (stated %dms)", GChannels[Channel].Name, Measured,
+             GChannels[Channel].LatencyMs);
+    Check(Name, Measured == GChannels[Channel].LatencyMs);
+  }
+}
+
+
+//
+// time the filter step for each channel setting, on a noisy input
+//
+void Benchmark(void)
+{
+  SADCFilter Filter;
+  int Channel;
+  long Cntr;
+  unsigned int Sum;
+  unsigned int Reading = 4000;
+  double PerSample;
+#ifdef VHAVECYCLECOUNTER
+  unsigned long long Start;
+#else
+  clock_t Start;
+#endif
+
+  for (Channel = 0; Channel < 5; Channel++)
+  {
+    memset(&Filter, 0, sizeof(Filter));
+    Sum = 0;
+#ifdef VHAVECYCLECOUNTER
+    Start = __rdtsc();
+#else
+    Start = clock();
+#endif
+    for (Cntr = 0; Cntr < VBENCHSAMPLES; Cntr++)
+    {
+      Reading = (Reading * 75 + 74) % 8185;                   // pseudo random readings
+      Sum += ADCFilterStep(&Filter, GChannels[Channel].Median, GChannels[Channel].IIRShift, Reading);
+    }
+#ifdef VHAVECYCLECOUNTER
+    PerSample = (double)(__rdtsc() - Start) / VBENCHSAMPLES;
+    printf("benchmark: %s channel (median %d, k=%d): %.1f cycles per sample\n", GChannels[Channel].Name,
+           GChannels[Channel].Median, GChannels[Channel].IIRShift, PerSample);
+#else
+    PerSample = (double)(clock() - Start) * 1E9 / CLOCKS_PER_SEC / VBENCHSAMPLES;
+    printf("benchmark: %s channel (median %d, k=%d): %.1fns per sample\n", GChannels[Channel].Name,
+           GChannels[Channel].Median, GChannels[Channel].IIRShift, PerSample);
+#endif
+    GBenchResult = Sum;
+  }
+}
+
+
+int main(void)
+{
+  TestMedian();
+  TestIIR();
+  TestChannelLatency();
+  Benchmark();
+  printf("%d failures\n", GFailures);
+  return (GFailures == 0) ? 0 : 1;
+}
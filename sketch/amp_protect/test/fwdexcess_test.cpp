@@ -0,0 +1,114 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// fwdexcess_test.cpp
+// host simulation test of the forward power excess detector (fwdexcess.cpp)
+// the Arduino IDE doesn't build files in test/. To build and run on a host:
+//   g++ -I.. -o fwdexcess_test fwdexcess_test.cpp ../fwdexcess.cpp && ./fwdexcess_test
+// prints each case, and returns non zero if any fails
+//
+// the trip rule trips when the detector output is above the trip level (see protect.cpp)
+// defaults: limit 1500W, time constant 100 ticks (1s), trip 100W mean excess
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <math.h>
+#include "fwdexcess.h"
+
+
+#define VLIMIT 1500
+#define VTAU 100
+#define VTRIP 100
+#define VNOTRIP -1
+
+
+int GFailures = 0;
+
+
+//
+// run a repeating power profile through the detector, starting from 0
+// Profile holds Length per tick power readings, repeated for Ticks ticks
+// returns the tick number (from 1) of the first trip, or VNOTRIP
+//
+long RunProfile(const int* Profile, int Length, long Ticks, int Limit, int Tau, int Trip)
+{
+  long Integral = 0;
+  long Tick;
+  long TripTick = VNOTRIP;
+
+  for (Tick = 0; (Tick < Ticks) && (TripTick == VNOTRIP); Tick++)
+    if (FwdExcessStep(&Integral, Profile[Tick % Length], Limit, Tau) > Trip)
+      TripTick = Tick + 1;
+  return TripTick;
+}
+
+
+//
+// report one case
+//
+void Check(const char* Name, bool Pass)
+{
+  printf("%s: %s\n", Pass ? "pass" : "FAIL", Name);
+  if (!Pass)
+    GFailures++;
+}
+
+
+//
+// SSB: short peaks above the limit, with a mean excess below the trip level, must never trip
+//
+void TestSSBPeaks(void)
+{
+  const int Syllables[10] = {1900, 1900, 300, 300, 300, 300, 300, 300, 300, 300};  // 20ms peaks every 100ms
+  const int Voice[25] = {2500, 2500, 800, 600, 400, 200, 100, 100, 100, 100,        // 20ms peaks every 250ms
+                         100, 100, 100, 100, 100, 100, 100, 100, 100, 100,
+                         100, 100, 100, 100, 100};
+  const int Burst[200] = {2500, 2500, 2500, 2500, 2500, 2500, 2500, 2500, 2500, 2500};  // one 100ms burst
+  const int AtLimit[1] = {VLIMIT + VTRIP};                                              // sustained, equal to trip
+
+  Check("SSB 1900W peaks, 20% duty, 10 minutes", RunProfile(Syllables, 10, 60000, VLIMIT, VTAU, VTRIP) == VNOTRIP);
+  Check("SSB 2500W peaks, 8% duty, 10 minutes", RunProfile(Voice, 25, 60000, VLIMIT, VTAU, VTRIP) == VNOTRIP);
+  Check("single 100ms burst at 2500W", RunProfile(Burst, 200, 200, VLIMIT, VTAU, VTRIP) == VNOTRIP);
+  Check("sustained excess equal to the trip level, 10 minutes", RunProfile(AtLimit, 1, 60000, VLIMIT, VTAU, VTRIP) == VNOTRIP);
+}
+
+
+//
+// sustained overdrive: an excess E above the trip level T must trip within Tau x ln(E/(E-T-1))
+// ticks (the continuous time bound for the whole watt output to pass T; one tick is allowed
+// for the sample that crosses it)
+//
+void TestSustained(void)
+{
+  const int Taus[3] = {10, 100, 1000};
+  const int Excesses[6] = {102, 110, 150, 200, 300, 1000};
+  int Power[1];
+  int TauCntr, ExcessCntr;
+  long TripTick;
+  double Bound;
+  char Name[80];
+
+  for (TauCntr = 0; TauCntr < 3; TauCntr++)
+    for (ExcessCntr = 0; ExcessCntr < 6; ExcessCntr++)
+    {
+      Power[0] = VLIMIT + Excesses[ExcessCntr];
+      Bound = Taus[TauCntr] * log((double)Excesses[ExcessCntr] / (Excesses[ExcessCntr] - VTRIP - 1));
+      TripTick = RunProfile(Power, 1, 100000, VLIMIT, Taus[TauCntr], VTRIP);
+      snprintf(Name, sizeof(Name), "sustained excess %dW, tau %d: trip at %ld, bound %.1f",
+               Excesses[ExcessCntr], Taus[TauCntr], TripTick, Bound);
+      Check(Name, (TripTick != VNOTRIP) && (TripTick <= (long)ceil(Bound) + 1));
+    }
+}
+
+
+int main(void)
+{
+  TestSSBPeaks();
+  TestSustained();
+  printf("%d failures\n", GFailures);
+  return (GFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// hwtrip_test.cpp
+// host test of the hardware trip register set up (hwtripconfig.cpp) against a register model
+// the Arduino IDE doesn't build files in test/. To build and run on a host:
+//   g++ -I.. -o hwtrip_test hwtrip_test.cpp ../hwtripconfig.cpp && ./hwtrip_test
+// prints each case, and returns non zero if any fails
+//
+// the model has the EVSYS, CCL and PORTMUX registers used. As on the device, the CCL LUT
+// registers ignore writes while the CCL is enabled. The model then decodes the event routing
+// and LUT input selection, and finds the LUT0 output pin level for given input pin levels.
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include "hwtripconfig.h"
+
+
+int GFailures = 0;
+
+
+//
+// a CCL register that can only be written while CCL.CTRLA ENABLE is clear
+//
+struct SProtectedReg
+{
+  unsigned char Value;
+  const unsigned char* CtrlA;
+  int IgnoredWrites;
+
+  SProtectedReg& operator=(unsigned char NewValue)
+  {
+    if ((*CtrlA & VCCLENABLE) == 0)
+      Value = NewValue;
+    else
+      IgnoredWrites++;
+    return *this;
+  }
+};
+
+
+struct SEvsysModel
+{
+  unsigned char CHANNEL4;
+  unsigned char CHANNEL5;
+  unsigned char USERCCLLUT0A;
+  unsigned char USERCCLLUT0B;
+};
+
+
+struct SCclModel
+{
+  unsigned char CTRLA;
+  SProtectedReg LUT0CTRLA;
+  SProtectedReg LUT0CTRLB;
+  SProtectedReg LUT0CTRLC;
+  SProtectedReg TRUTH0;
+};
+
+
+struct SPortmuxModel
+{
+  unsigned char CCLROUTEA;
+};
+
+
+//
+// reset the model to the device reset values (all 0)
+//
+void ResetModel(SEvsysModel* Evsys, SCclModel* Ccl, SPortmuxModel* Portmux)
+{
+  SProtectedReg* Regs[4] = {&Ccl->LUT0CTRLA, &Ccl->LUT0CTRLB, &Ccl->LUT0CTRLC, &Ccl->TRUTH0};
+  int Cntr;
+
+  *Evsys = SEvsysModel();
+  *Portmux = SPortmuxModel();
+  Ccl->CTRLA = 0;
+  for (Cntr = 0; Cntr < 4; Cntr++)
+  {
+    Regs[Cntr]->Value = 0;
+    Regs[Cntr]->CtrlA = &Ccl->CTRLA;
+    Regs[Cntr]->IgnoredWrites = 0;
+  }
+}
+
+
+//
+// input pin levels
+//
+struct SPins
+{
+  bool PA1;                                 // firmware amplifier enable
+  bool PE0;                                 // current comparator, high if tripped
+  bool PE3;                                 // SR flip flop, low if tripped
+};
+
+
+//
+// level of the event channel with this user value (0 = none), from its generator
+// channels 4 and 5: port 0 is port E, port 1 is port F (not modelled: reads 0)
+//
+bool EventLevel(SEvsysModel* Evsys, unsigned char User, SPins* Pins)
+{
+  unsigned char Generator = 0;
+  bool Level = false;
+
+  if (User == VEVUSERCHANNEL4)
+    Generator = Evsys->CHANNEL4;
+  else if (User == VEVUSERCHANNEL5)
+    Generator = Evsys->CHANNEL5;
+  if (Generator == VEVGENPORT0PIN0)
+    Level = Pins->PE0;
+  else if (Generator == VEVGENPORT0PIN3)
+    Level = Pins->PE3;
+  return Level;
+}
+
+
+//
+// level of one LUT0 input from its INSEL value
+// IO inputs for LUT0 are PA0, PA1, PA2 for IN0, IN1, IN2: only PA1 is modelled (others read 0)
+//
+bool LutInput(SEvsysModel* Evsys, unsigned char InSel, int Input, SPins* Pins)
+{
+  bool Level = false;
+
+  if (InSel == (VCCLINSEL0EVENTA & 0x0F))
+    Level = EventLevel(Evsys, Evsys->USERCCLLUT0A, Pins);
+  else if (InSel == VCCLINSEL2EVENTB)
+    Level = EventLevel(Evsys, Evsys->USERCCLLUT0B, Pins);
+  else if ((InSel == (VCCLINSEL1IO >> 4)) && (Input == 1))
+    Level = Pins->PA1;
+  return Level;
+}
+
+
+//
+// find whether LUT0 drives PA3, and its level
+//
+bool DrivesPA3(SCclModel* Ccl, SPortmuxModel* Portmux)
+{
+  return ((Ccl->CTRLA & VCCLENABLE) != 0) && ((Ccl->LUT0CTRLA.Value & VCCLENABLE) != 0) &&
+         ((Ccl->LUT0CTRLA.Value & VCCLOUTEN) != 0) && ((Portmux->CCLROUTEA & VPORTMUXLUT0ALT) == 0);
+}
+
+bool LutOutput(SEvsysModel* Evsys, SCclModel* Ccl, SPins* Pins)
+{
+  int Index = 0;
+
+  if (LutInput(Evsys, Ccl->LUT0CTRLB.Value & 0x0F, 0, Pins))
+    Index |= VLUTIN0;
+  if (LutInput(Evsys, Ccl->LUT0CTRLB.Value >> 4, 1, Pins))
+    Index |= VLUTIN1;
+  if (LutInput(Evsys, Ccl->LUT0CTRLC.Value & 0x0F, 2, Pins))
+    Index |= VLUTIN2;
+  return (Ccl->TRUTH0.Value & (1 << Index)) != 0;
+}
+
+
+//
+// report one case
+//
+void Check(const char* Name, bool Pass)
+{
+  printf("%s: %s\n", Pass ? "pass" : "FAIL", Name);
+  if (!Pass)
+    GFailures++;
+}
+
+
+//
+// check the PA3 output for all 8 input pin combinations
+//
+bool CheckGate(SEvsysModel* Evsys, SCclModel* Ccl, bool IsEnforced)
+{
+  SPins Pins;
+  int Combination;
+  bool Expected;
+  bool Result = true;
+
+  for (Combination = 0; Combination < 8; Combination++)
+  {
+    Pins.PA1 = (Combination & 1) != 0;
+    Pins.PE0 = (Combination & 2) != 0;
+    Pins.PE3 = (Combination & 4) != 0;
+    Expected = Pins.PA1;
+    if (IsEnforced)
+      Expected = Pins.PA1 && !Pins.PE0 && Pins.PE3;
+    if (LutOutput(Evsys, Ccl, &Pins) != Expected)
+      Result = false;
+  }
+  return Result;
+}
+
+
+//
+// set up from reset, as HardwareTripInit() does, then change enforcement as HardwareTripEnforce() does
+//
+void TestSetup(bool InitEnforced)
+{
+  SEvsysModel Evsys;
+  SCclModel Ccl;
+  SPortmuxModel Portmux;
+  SHwTripRegs Regs;
+  char Name[80];
+  const char* Mode;
+
+  Mode = InitEnforced ? "enforced at init" : "not enforced at init";
+  ResetModel(&Evsys, &Ccl, &Portmux);
+  Portmux.CCLROUTEA = VPORTMUXLUT0ALT;              // check it is put back to PA3
+  HwTripRegisterValues(InitEnforced, &Regs);
+  HwTripWriteRegisters(&Regs, Evsys, Ccl, Portmux);
+
+  snprintf(Name, sizeof(Name), "%s: PE0 routed to channel 4, LUT0 event A", Mode);
+  Check(Name, (Evsys.CHANNEL4 == 0x40) && (Evsys.USERCCLLUT0A == 0x05));
+  snprintf(Name, sizeof(Name), "%s: PE3 routed to channel 5, LUT0 event B", Mode);
+  Check(Name, (Evsys.CHANNEL5 == 0x43) && (Evsys.USERCCLLUT0B == 0x06));
+  snprintf(Name, sizeof(Name), "%s: LUT0 IN1 is the PA1 pin, output drives PA3", Mode);
+  Check(Name, ((Ccl.LUT0CTRLB.Value >> 4) == 0x05) && DrivesPA3(&Ccl, &Portmux));
+  snprintf(Name, sizeof(Name), "%s: no LUT register write ignored", Mode);
+  Check(Name, (Ccl.LUT0CTRLA.IgnoredWrites + Ccl.LUT0CTRLB.IgnoredWrites + Ccl.LUT0CTRLC.IgnoredWrites +
+               Ccl.TRUTH0.IgnoredWrites) == 0);
+  snprintf(Name, sizeof(Name), "%s: truth table 0x%02X", Mode, Ccl.TRUTH0.Value);
+  Check(Name, Ccl.TRUTH0.Value == (InitEnforced ? 0x40 : 0xCC));
+  snprintf(Name, sizeof(Name), "%s: gate output for all inputs", Mode);
+  Check(Name, CheckGate(&Evsys, &Ccl, InitEnforced));
+
+  HwTripWriteTruth(HwTripTruth(!InitEnforced), Ccl);
+  snprintf(Name, sizeof(Name), "%s, then changed: truth table 0x%02X", Mode, Ccl.TRUTH0.Value);
+  Check(Name, (Ccl.TRUTH0.Value == (InitEnforced ? 0xCC : 0x40)) && (Ccl.TRUTH0.IgnoredWrites == 0));
+  snprintf(Name, sizeof(Name), "%s, then changed: gate output for all inputs, still on PA3", Mode);
+  Check(Name, CheckGate(&Evsys, &Ccl, !InitEnforced) && DrivesPA3(&Ccl, &Portmux));
+}
+
+
+int main(void)
+{
+  Check("gated truth table is 0x40", HwTripTruth(true) == 0x40);
+  Check("follow truth table is 0xCC", HwTripTruth(false) == 0xCC);
+  TestSetup(false);
+  TestSetup(true);
+  printf("%d failures\n", GFailures);
+  return (GFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// tripstub_test.cpp
+// host test of the trip interrupt entry code (tripstub.h): its assembler text is run on a model
+// of the I/O registers it uses, counting AVRxt CPU cycles
+// the Arduino IDE doesn't build files in test/. To build and run on a host:
+//   g++ -I.. -o tripstub_test tripstub_test.cpp && ./tripstub_test
+// prints each case, and returns non zero if any fails
+//
+// checks: only register-free instructions that leave SREG alone (so no prologue is needed);
+// each enable output is cleared by the cycle count given in tripstub.h, within 1us;
+// nothing is written if protection isn't enforced; it ends by jumping to the rest of the handler.
+/////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "tripstub.h"
+
+
+#define VIOGPIOR0 0x1C                      // I/O addresses (ATmega4809 datasheet)
+#define VIOVPORTAOUT 0x01
+#define VAMPBIT 1                           // PA1
+#define VPSUBIT 0                           // PA0
+#define VBUDGETCYCLES 16                    // 1us at 16MHz
+
+#define STRINGIFY2(x) #x
+#define STRINGIFY(x) STRINGIFY2(x)
+
+int GFailures = 0;
+
+
+//
+// report one case
+//
+void Check(const char* Name, bool Pass)
+{
+  printf("%s: %s\n", Pass ? "pass" : "FAIL", Name);
+  if (!Pass)
+    GFailures++;
+}
+
+
+//
+// find an operand value: operands are bound by name, as protect.cpp does with the device header
+// returns -1 for anything else (eg a register)
+//
+int OperandValue(const char* Operand)
+{
+  int Value = -1;
+
+  if (strcmp(Operand, "%[gpior]") == 0)
+    Value = VIOGPIOR0;
+  else if (strcmp(Operand, "%[enforced]") == 0)
+    Value = VGPIORENFORCEDBITPOS;
+  else if (strcmp(Operand, "%[porta]") == 0)
+    Value = VIOVPORTAOUT;
+  else if (strcmp(Operand, "%[amp]") == 0)
+    Value = VAMPBIT;
+  else if (strcmp(Operand, "%[psu]") == 0)
+    Value = VPSUBIT;
+  return Value;
+}
+
+
+//
+// one instruction of the entry code
+//
+struct SInstruction
+{
+  char Mnemonic[8];
+  char Operand[2][32];
+  int NumOperands;
+};
+
+
+//
+// split the assembler text into instructions
+//
+int ParseStub(SInstruction* Instructions, int MaxInstructions)
+{
+  char Text[512];
+  char* Line;
+  char* Next;
+  char* Comma;
+  SInstruction* Instr;
+  int Count = 0;
+
+  strncpy(Text, VTRIPSTUBASM, sizeof(Text) - 1);
+  Text[sizeof(Text) - 1] = 0;
+  for (Line = strtok_r(Text, "\n\t", &Next); (Line != NULL) && (Count < MaxInstructions); Line = strtok_r(NULL, "\n\t", &Next))
+  {
+    Instr = Instructions + Count++;
+    memset(Instr, 0, sizeof(SInstruction));
+    sscanf(Line, "%7s", Instr->Mnemonic);
+    Line += strlen(Instr->Mnemonic);
+    while (*Line == ' ')
+      Line++;
+    if (*Line != 0)
+    {
+      Comma = strchr(Line, ',');
+      if (Comma != NULL)
+      {
+        *Comma = 0;
+        sscanf(Comma + 1, " %31s", Instr->Operand[1]);
+        Instr->NumOperands = 2;
+      }
+      else
+        Instr->NumOperands = 1;
+      sscanf(Line, "%31s", Instr->Operand[0]);
+    }
+  }
+  return Count;
+}
+
+
+//
+// run the entry code on the I/O register model
+// returns false on an instruction the entry code must not use.
+// sets the cycle (from the interrupt request) each enable output was cleared, or 0 if not
+//
+bool RunStub(unsigned char* Io, int* AmpCycle, int* PsuCycle, int* TotalCycles, char* JumpTarget)
+{
+  SInstruction Instructions[16];
+  SInstruction* Instr;
+  int Count, PC;
+  int Address, Bit;
+  int Cycle;
+  bool Skip = false;
+  bool Done = false;
+  bool Valid = true;
+
+  Count = ParseStub(Instructions, 16);
+  Cycle = VTRIPRESPONSECYCLES + VTRIPVECTORCYCLES;
+  *AmpCycle = 0;
+  *PsuCycle = 0;
+  JumpTarget[0] = 0;
+  for (PC = 0; (PC < Count) && !Done && Valid; PC++)
+  {
+    Instr = Instructions + PC;
+    Address = OperandValue(Instr->Operand[0]);
+    Bit = OperandValue(Instr->Operand[1]);
+    if (Skip)
+      Skip = false;                                 // cycle counted by the skipping instruction
+    else if ((strcmp(Instr->Mnemonic, "sbic") == 0) && (Instr->NumOperands == 2) && (Address >= 0) && (Bit >= 0))
+    {
+      Skip = ((Io[Address] & (1 << Bit)) == 0);
+      Cycle += Skip ? 2 : 1;
+    }
+    else if ((strcmp(Instr->Mnemonic, "cbi") == 0) && (Instr->NumOperands == 2) && (Address >= 0) && (Bit >= 0))
+    {
+      Cycle += 1;
+      Io[Address] &= ~(1 << Bit);
+      if ((Address == VIOVPORTAOUT) && (Bit == VAMPBIT))
+        *AmpCycle = Cycle;
+      if ((Address == VIOVPORTAOUT) && (Bit == VPSUBIT))
+        *PsuCycle = Cycle;
+    }
+    else if ((strcmp(Instr->Mnemonic, "jmp") == 0) && (Instr->NumOperands == 1))
+    {
+      Cycle += 3;
+      strcpy(JumpTarget, Instr->Operand[0]);
+      Done = true;
+    }
+    else
+      Valid = false;
+  }
+  *TotalCycles = Cycle;
+  return Valid && Done && (PC == Count);
+}
+
+
+int main(void)
+{
+  unsigned char Io[32];
+  int AmpCycle, PsuCycle, TotalCycles;
+  char JumpTarget[32];
+  char Name[100];
+  bool Valid;
+
+  memset(Io, 0, sizeof(Io));
+  Io[VIOGPIOR0] = (1 << VGPIORENFORCEDBITPOS) | 0x80;            // other GPIOR0 bits kept
+  Io[VIOVPORTAOUT] = (1 << VAMPBIT) | (1 << VPSUBIT) | 0x08;     // enables asserted, PA3 high
+  Valid = RunStub(Io, &AmpCycle, &PsuCycle, &TotalCycles, JumpTarget);
+  Check("enforced: only sbic, cbi on named I/O operands, then jmp", Valid);
+  snprintf(Name, sizeof(Name), "enforced: amplifier enable cleared at cycle %d (tripstub.h says %d)", AmpCycle, VTRIPAMPCYCLES);
+  Check(Name, (AmpCycle == VTRIPAMPCYCLES) && (AmpCycle <= VBUDGETCYCLES));
+  snprintf(Name, sizeof(Name), "enforced: PSU enable cleared at cycle %d (tripstub.h says %d)", PsuCycle, VTRIPPSUCYCLES);
+  Check(Name, (PsuCycle == VTRIPPSUCYCLES) && (PsuCycle <= VBUDGETCYCLES));
+  Check("enforced: only the two enable bits cleared", (Io[VIOVPORTAOUT] == 0x08) && (Io[VIOGPIOR0] == 0x81));
+  snprintf(Name, sizeof(Name), "enforced: jumps to %s at cycle %d", JumpTarget, TotalCycles);
+  Check(Name, strcmp(JumpTarget, STRINGIFY(TRIPBODY_vect)) == 0);
+
+  Io[VIOGPIOR0] = 0x80;
+  Io[VIOVPORTAOUT] = (1 << VAMPBIT) | (1 << VPSUBIT);
+  Valid = RunStub(Io, &AmpCycle, &PsuCycle, &TotalCycles, JumpTarget);
+  Check("not enforced: enables left asserted", Valid && (AmpCycle == 0) && (PsuCycle == 0) &&
+        (Io[VIOVPORTAOUT] == ((1 << VAMPBIT) | (1 << VPSUBIT))));
+  snprintf(Name, sizeof(Name), "not enforced: jumps to %s at cycle %d", JumpTarget, TotalCycles);
+  Check(Name, strcmp(JumpTarget, STRINGIFY(TRIPBODY_vect)) == 0);
+
+  printf("%d failures\n", GFailures);
+  return (GFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,247 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// thermal.cpp
+// this file holds the heatsink thermal estimator and the proportional fan control
+//
+// once per second the 1 second mean temperature is added to a history of the last
+// VTHERMALHISTORY seconds. The slope is the least squares fit through the history: long
+// enough to average over FT8 (15s) transmit/receive periods. If the heatsink is heating, the
+// time to reach the trip temperature is forecast from the slope; when it is less than the
+// warning time parameter, a pre-trip warning is sent over CAT (ZZZH) and the fan is run flat out.
+//
+// the fan pin (D6, PF4) is the TCB0 output (PORTMUX alternate pin). TCB0 is run in 8 bit PWM
+// mode from CLK/2, so the fan PWM is 8MHz / 255 = 31.4KHz: above hearing, and no ripple in the
+// fan speed. (The 10ms tick is on TCB2.) No wiring change from the old software PWM is needed,
+// but the fan driver must switch cleanly at 31KHz: drive a logic level MOSFET gate directly
+// (gate resistor 100R or less, not a slow transistor stage), with a flyback diode across a
+// 2 wire fan. A 4 wire fan's PWM input can be driven directly (it is specified for 21-28KHz,
+// but accepts 31KHz).
+// TCB0 runs continuously, as the trip latency instrumentation reads its count (see triplatency.h)
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include "thermal.h"
+#include "iopins.h"
+#include "analogueio.h"
+#include "sensorstats.h"
+#include "configdata.h"
+#include "cathandler.h"
+
+
+#define VTHERMALHISTORY 32                  // seconds of history for the slope
+#define VSLOPEDENOM 10912L                  // sum of squared weights (2i - 31), i = 0..31
+#define VMINSLOPE 5                         // 0.005C/s (0.3C per minute): below this, no forecast
+#define VMAXFORECAST 9999                   // seconds
+#define VTICKSPERSECOND 100
+#define VFANFULLDUTY 255                    // analogWrite() duty values
+#define VFANMINDUTY 64                      // duty when just switched on (25%)
+
+
+int GTempHistory[VTHERMALHISTORY];          // 1DP C, ring of 1 second means
+byte GTempHistoryHead;                      // ring index of oldest sample
+byte GTempHistoryCount;                     // number of valid samples
+byte GThermalTickCount;                     // ticks until next history sample
+int GTemperatureSlope;                      // 0.001C per second
+unsigned int GTimeToTrip;                   // seconds
+bool GThermalWarning;
+bool GFanEnabled;
+byte GFanDuty;                              // duty last written to the PWM
+
+
+
+//
+// initialise - clear the temperature history and turn the fan off
+//
+void ThermalInit(void)
+{
+  GTempHistoryHead = 0;
+  GTempHistoryCount = 0;
+  GThermalTickCount = VTICKSPERSECOND;
+  GTemperatureSlope = 0;
+  GTimeToTrip = VNOFORECAST;
+  GThermalWarning = false;
+  GFanEnabled = false;
+  GFanDuty = 0;
+  digitalWrite(VPINFAN, LOW);
+
+  TCB0.CTRLA = 0;                                         // stop while configuring
+  TCB0.CTRLB = TCB_CNTMODE_PWM8_gc;
+  TCB0.CCMPL = VFANPWMTOP;                                // period: 255 counts
+  TCB0.CCMPH = 0;
+  TCB0.CNT = 0;
+  TCB0.INTCTRL = 0;
+  PORTMUX.TCBROUTEA |= PORTMUX_TCB0_bm;                   // output on PF4 (D6)
+  TCB0.CTRLA = TCB_CLKSEL_CLKDIV2_gc | TCB_ENABLE_bm;
+}
+
+
+//
+// enable or disable the fan (from the fan on/off hysteresis rule)
+// when enabled, the speed is set by the thermal estimator
+//
+void SetFanEnable(bool Enabled)
+{
+  GFanEnabled = Enabled;
+}
+
+
+//
+// add a 1 second sample to the history, then refit the slope
+// slope = sum((i - 15.5) x T(i)) / sum((i - 15.5)^2) per second; weights are doubled to keep
+// them integer, so the 1DP slope is 2 x sum(w x T) / VSLOPEDENOM, and x100 for 0.001C/s
+//
+void UpdateTemperatureSlope(int Temperature)
+{
+  byte Cntr;
+  byte Index;
+  long Sum = 0;
+
+  if (GTempHistoryCount < VTHERMALHISTORY)
+    GTempHistory[GTempHistoryCount++] = Temperature;     // filling: oldest stays at index 0
+  else
+  {
+    GTempHistory[GTempHistoryHead] = Temperature;         // overwrite the oldest
+    if (++GTempHistoryHead >= VTHERMALHISTORY)
+      GTempHistoryHead = 0;
+  }
+
+  if (GTempHistoryCount == VTHERMALHISTORY)
+  {
+    Index = GTempHistoryHead;
+    for (Cntr = 0; Cntr < VTHERMALHISTORY; Cntr++)
+    {
+      Sum += (long)(2 * Cntr - (VTHERMALHISTORY - 1)) * GTempHistory[Index];
+      if (++Index >= VTHERMALHISTORY)
+        Index = 0;
+    }
+    GTemperatureSlope = (Sum * 200L) / VSLOPEDENOM;
+  }
+}
+
+
+//
+// forecast the time to trip from the slope, and set or clear the pre-trip warning
+// the warning clears when the forecast is more than twice the warning time
+//
+void UpdateTripForecast(int Temperature)
+{
+  int TripTemp;
+  int WarnTime;
+  long Forecast;
+
+  TripTemp = GConfig.Param[eParamTripTemp];
+  WarnTime = GConfig.Param[eParamThermalWarnTime];
+  GTimeToTrip = VNOFORECAST;
+  if (GTemperatureSlope >= VMINSLOPE)
+  {
+    Forecast = 0;
+    if (Temperature < TripTemp)
+      Forecast = ((long)(TripTemp - Temperature) * 100L) / GTemperatureSlope;
+    if (Forecast > VMAXFORECAST)
+      Forecast = VMAXFORECAST;
+    GTimeToTrip = (unsigned int)Forecast;
+  }
+
+  if ((WarnTime != 0) && (GTimeToTrip <= (unsigned int)WarnTime))
+  {
+    if (!GThermalWarning)
+    {
+      GThermalWarning = true;
+      MakeThermalMessage();                               // unsolicited pre-trip warning
+    }
+  }
+  else if ((WarnTime == 0) || (GTimeToTrip == VNOFORECAST) || (GTimeToTrip > 2 * (unsigned int)WarnTime))
+    GThermalWarning = false;
+}
+
+
+//
+// find the fan duty (0 to VFANFULLDUTY) for the current temperature
+// proportional from VFANMINDUTY at the fan off temperature to full at the trip temperature;
+// full whenever the pre-trip warning is active
+//
+byte FindFanDuty(int Temperature)
+{
+  int FanOff;
+  int Span;
+  long Duty = 0;
+
+  if (GFanEnabled || GThermalWarning)
+  {
+    FanOff = GConfig.Param[eParamFanOff];
+    Span = GConfig.Param[eParamTripTemp] - FanOff;
+    Duty = VFANFULLDUTY;
+    if ((Span > 0) && !GThermalWarning)
+    {
+      Duty = VFANMINDUTY + ((long)(Temperature - FanOff) * (VFANFULLDUTY - VFANMINDUTY)) / Span;
+      if (Duty < VFANMINDUTY)
+        Duty = VFANMINDUTY;
+      if (Duty > VFANFULLDUTY)
+        Duty = VFANFULLDUTY;
+    }
+  }
+  return (byte)Duty;
+}
+
+
+//
+// 10ms tick: sample the temperature history, update the forecast and drive the fan
+//
+void ThermalTick(void)
+{
+  int Temperature;
+  byte Duty;
+
+  Temperature = GetTemperature();
+  if (--GThermalTickCount == 0)
+  {
+    GThermalTickCount = VTICKSPERSECOND;
+    UpdateTemperatureSlope(GetStatistic(eStatsTemperature, eStatsWindow1s, eStatsMean));
+    UpdateTripForecast(Temperature);
+  }
+
+//
+// only written when it changes: a write part way through a PWM period gives one odd period.
+// analogWrite() sets the TCB0 compare value; 0 and full duty turn the PWM off and drive the pin
+// low or high, but leave TCB0 counting
+//
+  Duty = FindFanDuty(Temperature);
+  if (Duty != GFanDuty)
+  {
+    GFanDuty = Duty;
+    analogWrite(VPINFAN, Duty);
+  }
+}
+
+
+//
+// get the heatsink temperature slope, in 0.001C per second (negative if cooling)
+//
+int GetTemperatureSlope(void)
+{
+  return GTemperatureSlope;
+}
+
+
+//
+// get the forecast time until the trip temperature is reached, in seconds
+// returns VNOFORECAST if the heatsink isn't heating (or the history isn't full yet)
+//
+unsigned int GetTimeToTrip(void)
+{
+  return GTimeToTrip;
+}
+
+
+//
+// return true if the pre-trip warning is active
+//
+bool ThermalWarningActive(void)
+{
+  return GThermalWarning;
+}
@@ -0,0 +1,61 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// thermal.h
+// this file holds the heatsink thermal estimator (temperature slope and time to trip forecast)
+// and the proportional fan control
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __THERMAL_H
+#define __THERMAL_H
+
+#include <Arduino.h>
+
+
+#define VNOFORECAST 0xFFFF                  // time to trip when the heatsink isn't heating
+#define VFANPWMTOP 254                      // fan PWM (TCB0) counts 0-254 at 0.125us: 31.4KHz
+
+
+//
+// initialise - clear the temperature history and turn the fan off
+//
+void ThermalInit(void);
+
+
+//
+// enable or disable the fan (from the fan on/off hysteresis rule)
+// when enabled, the speed is set by the thermal estimator
+//
+void SetFanEnable(bool Enabled);
+
+
+//
+// 10ms tick: sample the temperature history, update the forecast and drive the fan
+//
+void ThermalTick(void);
+
+
+//
+// get the heatsink temperature slope, in 0.001C per second (negative if cooling)
+//
+int GetTemperatureSlope(void);
+
+
+//
+// get the forecast time until the trip temperature is reached, in seconds
+// returns VNOFORECAST if the heatsink isn't heating (or the history isn't full yet)
+//
+unsigned int GetTimeToTrip(void);
+
+
+//
+// return true if the pre-trip warning is active
+//
+bool ThermalWarningActive(void);
+
+
+#endif      // file sentry
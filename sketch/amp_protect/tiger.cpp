@@ -21,7 +21,7 @@
 #define VBUFLENGTH 128
 char GCATInputBuffer[VBUFLENGTH];
 char* GCATWritePtr;
-char Output[40];                                        // TX CAT msg buffer
+char Output[48];                                        // TX CAT msg buffer
 byte GNumCommands;                                      // number of commands in table
 
 
@@ -55,11 +55,20 @@ long DivisorTable[] =
 // (not including the final eNoCommand)
 // string, type, min value, max value, #digits, true if always signed
 //
-#define VNUMCATCMDS 2
+#define VNUMCATCMDS 11
 SCATCommands GCATCommands[VNUMCATCMDS] = 
 {
   {"ZZZA", eNum, 0, 64, 2, false},                        // amplifier trip report
-  {"ZZZS", eNum, 0, 9999999, 7, false}                    // s/w version
+  {"ZZZS", eNum, 0, 9999999, 7, false},                   // s/w version
+  {"ZZZM", eNum, 0, 99999999, 8, false},                  // sensor statistics
+  {"ZZZL", eNum, 0, 999999999, 9, false},                 // trip latency statistics
+  {"ZZZT", eNum, 0, 999999999, 9, false},                 // trip causes
+  {"ZZZR", eNum, 0, 999, 35, false},                      // flight recorder (string reply)
+  {"ZZZE", eNum, 0, 99, 32, false},                       // event log (string reply)
+  {"ZZZC", eNum, 0, 19999999, 7, false},                  // config parameters (8 digits to write)
+  {"ZZZW", eNum, 0, 99999999, 8, false},                  // SWR and return loss (query only)
+  {"ZZZH", eNum, 0, 99999999, 8, false},                  // thermal forecast (query only)
+  {"ZZZP", eNum, 0, 9999999, 7, false}                    // task execution profile
 };
 
 
@@ -21,6 +21,15 @@ enum ECATCommands
 {
   eZZZA,                          // amplifier trip
   eZZZS,                          // s/w version
+  eZZZM,                          // sensor statistics
+  eZZZL,                          // trip latency statistics
+  eZZZT,                          // trip causes
+  eZZZR,                          // flight recorder download
+  eZZZE,                          // event log read
+  eZZZC,                          // config parameter read/write
+  eZZZW,                          // SWR and return loss
+  eZZZH,                          // heatsink thermal forecast
+  eZZZP,                          // task execution profile
   eNoCommand                      // this is an exception condition
 };
 
@@ -0,0 +1,144 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// triplatency.cpp
+// this file holds the trip latency instrumentation: the time from entry to a hardware
+// trip interrupt handler to the enable outputs being deasserted, measured using the count of
+// the fan PWM timer (TCB0)
+//
+// TCB3 is used by the Arduino core for millis(); TCB2 is the 10ms tick; TCB1 drives
+// PWM on pin 3. No timer is spare, but the times measured are a few us, so the fan PWM
+// timer (TCB0, CLK/2, wraps every VFANPWMTOP+1 counts = 31.9us) is used.
+/////////////////////////////////////////////////////////////////////////
+
+#include <Arduino.h>
+#include "triplatency.h"
+#include "thermal.h"
+
+
+#define VCOUNTSPERUS 8                      // 16MHz / 2
+
+//
+// statistics for one trip path, in timer counts
+//
+struct SLatencyStats
+{
+  unsigned int Count;                       // number of trips timed (saturates)
+  unsigned int Min;
+  unsigned int Max;
+  unsigned int Last;
+  unsigned int Histogram[VLATENCYBINS];     // octave bins (saturate)
+};
+
+volatile SLatencyStats GLatencyStats[VNUMLATENCYPATHS];
+
+
+
+//
+// initialise - clear the statistics (the timer is started by ThermalInit())
+//
+void TripLatencyInit(void)
+{
+  ClearTripLatency();
+}
+
+
+//
+// clear all latency statistics
+//
+void ClearTripLatency(void)
+{
+  byte Path, Bin;
+
+  noInterrupts();
+  for (Path = 0; Path < VNUMLATENCYPATHS; Path++)
+  {
+    GLatencyStats[Path].Count = 0;
+    GLatencyStats[Path].Min = 0xFFFF;
+    GLatencyStats[Path].Max = 0;
+    GLatencyStats[Path].Last = 0;
+    for (Bin = 0; Bin < VLATENCYBINS; Bin++)
+      GLatencyStats[Path].Histogram[Bin] = 0;
+  }
+  interrupts();
+}
+
+
+//
+// record one timed trip (called from ProtectTick with the timestamps saved by the trip interrupt)
+// parameters are the timestamps at handler entry and after the outputs were written
+// the timer counts 0 to VFANPWMTOP, so a wrap between the two adds VFANPWMTOP+1 counts
+//
+void RecordTripLatency(ELatencyPath Path, byte EntryTime, byte WriteTime)
+{
+  unsigned int Latency;
+  unsigned int Microseconds;
+  byte Bin = 0;
+  volatile SLatencyStats* Stats;
+
+  Stats = GLatencyStats + (int)Path;
+  Latency = WriteTime - EntryTime;
+  if (WriteTime < EntryTime)
+    Latency = WriteTime + (VFANPWMTOP + 1) - EntryTime;
+  Stats->Last = Latency;
+  if (Latency < Stats->Min)
+    Stats->Min = Latency;
+  if (Latency > Stats->Max)
+    Stats->Max = Latency;
+  if (Stats->Count != 0xFFFF)
+    Stats->Count++;
+//
+// find octave bin: bin 0 is <1us, bin n is 2^(n-1) to 2^n us
+//
+  Microseconds = Latency / VCOUNTSPERUS;
+  while ((Microseconds != 0) && (Bin < (VLATENCYBINS - 1)))
+  {
+    Microseconds >>= 1;
+    Bin++;
+  }
+  if (Stats->Histogram[Bin] != 0xFFFF)
+    Stats->Histogram[Bin]++;
+}
+
+
+//
+// read a latency statistic for one path
+// Bin is only used for eLatencyHistogram
+// times are returned in 0.1us units; min is returned as 0 if nothing has been timed
+//
+unsigned long GetTripLatency(ELatencyPath Path, ELatencyStat Stat, byte Bin)
+{
+  unsigned long Result = 0;
+  volatile SLatencyStats* Stats;
+
+  Stats = GLatencyStats + (int)Path;
+  noInterrupts();
+  switch (Stat)
+  {
+    case eLatencyCount:
+      Result = Stats->Count;
+      break;
+    case eLatencyMin:
+      if (Stats->Count != 0)
+        Result = Stats->Min;
+      break;
+    case eLatencyMax:
+      Result = Stats->Max;
+      break;
+    case eLatencyLast:
+      Result = Stats->Last;
+      break;
+    case eLatencyHistogram:
+      if (Bin < VLATENCYBINS)
+        Result = Stats->Histogram[Bin];
+      break;
+  }
+  interrupts();
+  if (Stat != eLatencyCount && Stat != eLatencyHistogram)
+    Result = (Result * 10) / VCOUNTSPERUS;                    // counts to 0.1us
+  return Result;
+}
@@ -0,0 +1,89 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// triplatency.h
+// this file holds the trip latency instrumentation: the time from entry to a hardware
+// trip interrupt handler to the enable outputs being deasserted, measured using the count of
+// the fan PWM timer (TCB0), which runs continuously
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __TRIPLATENCY_H
+#define __TRIPLATENCY_H
+
+#include <Arduino.h>
+
+
+//
+// hardware trip paths that are timed
+//
+enum ELatencyPath
+{
+  eLatencyCurrent,                          // current comparator
+  eLatencyVoltage,                          // PSU voltage comparator
+  eLatencyRevPower                          // reverse power SR flip flop
+};
+#define VNUMLATENCYPATHS 3
+
+
+//
+// latency statistic to read
+// the histogram bins are octaves in microseconds: <1us, 1-2us, 2-4us ... >=16us
+// (the timer wraps every 31.9us, so longer times can't be measured)
+//
+enum ELatencyStat
+{
+  eLatencyCount,                            // number of trips timed
+  eLatencyMin,                              // 0.1us units
+  eLatencyMax,                              // 0.1us units
+  eLatencyLast,                             // 0.1us units
+  eLatencyHistogram                         // first histogram bin; bins follow
+};
+#define VLATENCYBINS 6
+
+
+//
+// define this to time the trip handler path. This costs a timer read before the enable
+// outputs are deasserted, so leave it undefined in normal use to keep the deassert as the
+// first action of the trip interrupt. If undefined, ZZZL requests get a "not compiled in" reply.
+//
+//#define VTIMETRIPLATENCY
+
+
+//
+// read the timestamp (TCB0 count, 0.125us per count: counts 0 to VFANPWMTOP, then wraps)
+// used at ISR entry and after the enable outputs have been written
+//
+#define LATENCYTIMESTAMP() (TCB0.CNTL)
+
+
+//
+// initialise - clear the statistics (the timer is started by ThermalInit())
+//
+void TripLatencyInit(void);
+
+
+//
+// clear all latency statistics
+//
+void ClearTripLatency(void);
+
+
+//
+// record one timed trip (called from ProtectTick with the timestamps saved by the trip interrupt)
+// parameters are the timestamps at handler entry and after the outputs were written
+//
+void RecordTripLatency(ELatencyPath Path, byte EntryTime, byte WriteTime);
+
+
+//
+// read a latency statistic for one path
+// Bin is only used for eLatencyHistogram
+//
+unsigned long GetTripLatency(ELatencyPath Path, ELatencyStat Stat, byte Bin);
+
+
+#endif      // file sentry
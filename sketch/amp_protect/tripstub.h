@@ -0,0 +1,58 @@
+/////////////////////////////////////////////////////////////////////////
+//
+// Amplifier protection code by Laurence Barker G8NJJ
+// copyright (c) Laurence Barker G8NJJ 2019
+//
+// this sketch provides a control mechanism for an LDMOS amplifier
+//
+// tripstub.h
+// this file holds the entry code of the hardware trip interrupt (see protect.cpp), as AVR assembler
+// it has no Arduino dependencies, so it can also be checked on a host (see test/)
+//
+// the entry code uses no registers and doesn't change SREG, so the handler needs no prologue
+// before it: its first instruction is the first one run from the vector. If protection is
+// enforced (a bit in GPIOR0, which sbic tests directly) each enable output is cleared by one cbi.
+// It then jumps to the rest of the handler, a normal signal handler that saves the registers
+// it uses and ends with reti.
+/////////////////////////////////////////////////////////////////////////
+
+#ifndef __TRIPSTUB_H
+#define __TRIPSTUB_H
+
+
+#define VGPIORENFORCEDBITPOS 0              // GPIOR0 bit: set while protection is enforced
+
+
+//
+// the entry code. Operands (bound in protect.cpp):
+// %[gpior]: GPIOR0 I/O address; %[enforced]: VGPIORENFORCEDBITPOS
+// %[porta]: VPORTA.OUT I/O address; %[amp], %[psu]: enable output bit numbers
+//
+#define VTRIPSTUBASM                                                          \
+  "sbic %[gpior], %[enforced]\n\t"          /* skip if not enforced */        \
+  "cbi %[porta], %[amp]\n\t"                /* deassert VPINAMPENABLE */      \
+  "sbic %[gpior], %[enforced]\n\t"                                            \
+  "cbi %[porta], %[psu]\n\t"                /* deassert VPINPSUENABLE */      \
+  "jmp __vector_trip_body\n\t"              /* rest of the handler */
+
+
+//
+// the rest of the handler: not a hardware vector. (The __vector prefix stops the compiler
+// warning that a signal handler name looks misspelled)
+//
+#define TRIPBODY_vect __vector_trip_body
+
+
+//
+// cycles from the interrupt request to each enable output being written, with protection
+// enforced (ATmega4809 AVRxt CPU, 16MHz: 62.5ns per cycle). Checked by the host test.
+// the interrupt is only taken when the instruction running has completed, and not while
+// interrupts are disabled: as the level 1 vector, no other interrupt handler delays it.
+//
+#define VTRIPRESPONSECYCLES 3               // program counter pushed
+#define VTRIPVECTORCYCLES 3                 // JMP in the vector table
+#define VTRIPAMPCYCLES 8                    // amplifier enable clear: 0.5us
+#define VTRIPPSUCYCLES 10                   // PSU enable clear: 0.625us
+
+
+#endif      // file sentry